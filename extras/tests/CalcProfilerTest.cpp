@@ -0,0 +1,111 @@
+/*
+ * SmartMatrix Library - Host test for MatrixCalcProfiler.h
+ *
+ * Builds the profiler with SMARTMATRIX_CALC_PROFILING defined, the configuration that isn't compiled by default, and
+ * checks the stats it keeps for a few simulated frames: per-layer stages, layers only added by their
+ * frameRefreshCallback(), packing time reported without the layers' fill time, time summed across calc contexts, and
+ * min/max/average/histogram.  Build and run on the host with:
+ *
+ *   g++ -std=gnu++11 -Wall -I../../src -o CalcProfilerTest CalcProfilerTest.cpp && ./CalcProfilerTest
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// the profiler only needs SM_Layer pointers and a tick source, host builds count ticks with micros()
+class SM_Layer { };
+static uint32_t fakeMicros;
+static uint32_t micros(void) { return fakeMicros; }
+
+#define SMARTMATRIX_CALC_PROFILING
+#include "../../src/MatrixCalcProfiler.h"
+
+static int failures;
+
+static void expect(const char * what, uint32_t value, uint32_t expected) {
+    if(value != expected) {
+        printf("%s is %u, expected %u\n", what, (unsigned)value, (unsigned)expected);
+        failures++;
+    }
+}
+
+// one simulated frame: a callback for each layer, two rows filled by each of two contexts, and a buffer handoff
+static void simulateFrame(SM_Layer * layer0, SM_Layer * layer1, uint32_t fillMicros, uint32_t packMicros) {
+    SM_CALC_PROFILE_BEGIN_FRAME();
+
+    SM_CALC_PROFILE_START(callbackStartTicks);
+    fakeMicros += 3;
+    SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, layer0, 0, SM_CALC_PROFILE_ELAPSED(callbackStartTicks));
+    SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, layer1, 0, 5);
+
+    for(int context=0; context<SM_CALC_PROFILE_MAX_CONTEXTS; context++) {
+        // packing is recorded including the fill time of the rows it packs
+        SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, layer0, context, fillMicros);
+        SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, layer1, context, fillMicros);
+        SM_CALC_PROFILE_ADD(calcStageBitplanePacking, NULL, context, packMicros + (2 * fillMicros));
+    }
+
+    SM_CALC_PROFILE_ADD(calcStageBufferHandoff, NULL, 0, 1);
+
+    SM_CALC_PROFILE_END_FRAME();
+}
+
+int main(void) {
+    SM_Layer layer0, layer1, unusedLayer;
+    calcProfileStats stats;
+
+    SmartMatrixCalcProfiler::reset();
+
+    if(SmartMatrixCalcProfiler::getStats(calcStageBitplanePacking, NULL, &stats)) {
+        printf("stats reported before the first frame\n");
+        failures++;
+    }
+
+    // fill time for a layer is dropped until its frameRefreshCallback() is recorded, the dual core worker never adds layers
+    SM_CALC_PROFILE_BEGIN_FRAME();
+    SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, &unusedLayer, 1, 7);
+    SM_CALC_PROFILE_END_FRAME();
+
+    simulateFrame(&layer0, &layer1, 10, 100);
+    simulateFrame(&layer0, &layer1, 20, 300);
+
+    if(SmartMatrixCalcProfiler::getStats(calcStageFrameRefreshCallback, &unusedLayer, &stats) ||
+        SmartMatrixCalcProfiler::getStats(calcStageFillRefreshRow, &unusedLayer, &stats)) {
+        printf("stats reported for a layer that wasn't recorded\n");
+        failures++;
+    }
+
+    SmartMatrixCalcProfiler::getStats(calcStageFrameRefreshCallback, &layer0, &stats);
+    expect("layer0 callback last", stats.lastMicros, 3);
+    SmartMatrixCalcProfiler::getStats(calcStageFrameRefreshCallback, &layer1, &stats);
+    expect("layer1 callback last", stats.lastMicros, 5);
+
+    // fill time is summed across both contexts
+    SmartMatrixCalcProfiler::getStats(calcStageFillRefreshRow, &layer1, &stats);
+    expect("layer1 fill last", stats.lastMicros, 40);
+    expect("layer1 fill min", stats.minMicros, 20);
+
+    // packing is reported without the fill time, summed across both contexts
+    SmartMatrixCalcProfiler::getStats(calcStageBitplanePacking, NULL, &stats);
+    expect("packing frames", stats.frames, 2);
+    expect("packing last", stats.lastMicros, 600);
+    expect("packing min", stats.minMicros, 200);
+    expect("packing max", stats.maxMicros, 600);
+    expect("packing average", stats.averageMicros, 400);
+    // 200us is in bin 8 (128-255us), 600us in bin 10 (512-1023us)
+    expect("packing histogram bin 8", stats.histogram[8], 1);
+    expect("packing histogram bin 10", stats.histogram[10], 1);
+
+    SmartMatrixCalcProfiler::getStats(calcStageBufferHandoff, NULL, &stats);
+    expect("handoff last", stats.lastMicros, 1);
+
+    SmartMatrixCalcProfiler::reset();
+    if(SmartMatrixCalcProfiler::getStats(calcStageBitplanePacking, NULL, &stats)) {
+        printf("stats reported after reset()\n");
+        failures++;
+    }
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * SmartMatrix Library - Host test for extractHub75Bitplanes()
+ *
+ * Compares extractHub75Bitplanes() against the per-bit mask loop the HUB75 calc classes used before it, for rgb24 and
+ * rgb48 rows, every firstBit/numBits combination, step +1 and -1, and partial blocks.  Build and run on the host with:
+ *
+ *   g++ -std=gnu++11 -Wall -I../../src -o Hub75BitplanesTest Hub75BitplanesTest.cpp && ./Hub75BitplanesTest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// only the fields the bitplane helpers use, MatrixCommon.h needs Arduino.h
+typedef struct rgb24 { uint8_t red, green, blue; } rgb24;
+typedef struct rgb48 { uint16_t red, green, blue; } rgb48;
+#include "../../src/MatrixCommonHub75.h"
+#include "../../src/MatrixHub75Bitplanes.h"
+
+#define TRIALS_PER_CASE     20
+
+// the loop extractHub75Bitplanes() replaced: test each channel of each pixel against the mask for each bitplane
+template <typename RGB_TEMP>
+static void referenceBitplanes(const RGB_TEMP * row0, const RGB_TEMP * row1, int step, int numPixels, int firstBit,
+    int numBits, uint8_t bitplanes[][HUB75_BITPLANE_BLOCK_PIXELS]) {
+    for(int j=0; j<numBits; j++) {
+        uint16_t mask = (1 << (j + firstBit));
+
+        for(int k=0; k<HUB75_BITPLANE_BLOCK_PIXELS; k++) {
+            uint8_t v = 0;
+
+            if(k < numPixels) {
+                if (row0[k * step].red & mask)
+                    v |= HUB75_COLOR_INDEX_R0;
+                if (row0[k * step].green & mask)
+                    v |= HUB75_COLOR_INDEX_G0;
+                if (row0[k * step].blue & mask)
+                    v |= HUB75_COLOR_INDEX_B0;
+                if (row1[k * step].red & mask)
+                    v |= HUB75_COLOR_INDEX_R1;
+                if (row1[k * step].green & mask)
+                    v |= HUB75_COLOR_INDEX_G1;
+                if (row1[k * step].blue & mask)
+                    v |= HUB75_COLOR_INDEX_B1;
+            }
+
+            bitplanes[j][k] = v;
+        }
+    }
+}
+
+template <typename RGB_TEMP>
+static int testExtract(const char * name, int channelBits) {
+    int failures = 0;
+    int cases = 0;
+    uint32_t channelMask = (1UL << channelBits) - 1;
+
+    for(int firstBit=0; firstBit<channelBits; firstBit++) {
+        for(int numBits=1; firstBit + numBits <= channelBits; numBits++) {
+            for(int step=-1; step<=1; step+=2) {
+                for(int numPixels=1; numPixels<=HUB75_BITPLANE_BLOCK_PIXELS; numPixels++) {
+                    for(int trial=0; trial<TRIALS_PER_CASE; trial++) {
+                        RGB_TEMP row0[HUB75_BITPLANE_BLOCK_PIXELS];
+                        RGB_TEMP row1[HUB75_BITPLANE_BLOCK_PIXELS];
+
+                        // fill the whole block so pixels past numPixels would show up if they were read
+                        for(int i=0; i<HUB75_BITPLANE_BLOCK_PIXELS; i++) {
+                            row0[i].red = rand() & channelMask;
+                            row0[i].green = rand() & channelMask;
+                            row0[i].blue = rand() & channelMask;
+                            row1[i].red = rand() & channelMask;
+                            row1[i].green = rand() & channelMask;
+                            row1[i].blue = rand() & channelMask;
+                        }
+
+                        // a reversed block is read from its last pixel
+                        const RGB_TEMP * start0 = (step < 0) ? &row0[numPixels - 1] : row0;
+                        const RGB_TEMP * start1 = (step < 0) ? &row1[numPixels - 1] : row1;
+
+                        uint8_t expected[16][HUB75_BITPLANE_BLOCK_PIXELS];
+                        uint8_t actual[16][HUB75_BITPLANE_BLOCK_PIXELS];
+                        uint8_t actualScratch[16][HUB75_BITPLANE_BLOCK_PIXELS];
+                        hub75BitplaneScratch scratch;
+
+                        referenceBitplanes(start0, start1, step, numPixels, firstBit, numBits, expected);
+                        extractHub75Bitplanes(start0, start1, step, numPixels, firstBit, numBits, actual);
+                        extractHub75Bitplanes(start0, start1, step, numPixels, firstBit, numBits, actualScratch, scratch);
+
+                        for(int j=0; j<numBits; j++) {
+                            for(int k=0; k<HUB75_BITPLANE_BLOCK_PIXELS; k++) {
+                                if(actual[j][k] != expected[j][k] || actualScratch[j][k] != expected[j][k]) {
+                                    if(failures < 10)
+                                        printf("%s: firstBit %d numBits %d step %d numPixels %d: bitplane %d pixel %d is 0x%02X/0x%02X, expected 0x%02X\n",
+                                            name, firstBit, numBits, step, numPixels, j, k, actual[j][k], actualScratch[j][k], expected[j][k]);
+                                    failures++;
+                                }
+                            }
+                        }
+                        cases++;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%s: %d cases, %d mismatches\n", name, cases, failures);
+    return failures;
+}
+
+int main(void) {
+    int failures = 0;
+
+    srand(1);
+    failures += testExtract<rgb24>("rgb24", 8);
+    failures += testExtract<rgb48>("rgb48", 16);
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * SmartMatrix Library - Host test for calibrateHub75Pixels()
+ *
+ * Calibrates spans of a synthetic 4x3 panel layout and compares them against a per-pixel reference, for rgb24 and rgb48
+ * rows.  Checks spans that cross panel boundaries, saturation at 0xFF/0xFFFF, negative offsets, and that panels left at
+ * SM_PANEL_CALIBRATION_NONE are skipped.  Build and run on the host with:
+ *
+ *   g++ -std=gnu++11 -Wall -I../../src -o Hub75CalibrationTest Hub75CalibrationTest.cpp && ./Hub75CalibrationTest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// only the fields the bitplane helpers use, MatrixCommon.h needs Arduino.h
+typedef struct rgb24 { uint8_t red, green, blue; } rgb24;
+typedef struct rgb48 { uint16_t red, green, blue; } rgb48;
+#include "../../src/MatrixCommonHub75.h"
+#include "../../src/MatrixHub75Bitplanes.h"
+
+#define PANEL_WIDTH         32
+#define PANEL_HEIGHT        16
+#define PANELS_PER_ROW      4
+#define PANEL_ROWS          3
+#define NUM_PANELS          (PANELS_PER_ROW * PANEL_ROWS)
+#define LAYOUT_WIDTH        (PANEL_WIDTH * PANELS_PER_ROW)
+#define LAYOUT_HEIGHT       (PANEL_HEIGHT * PANEL_ROWS)
+#define RANDOM_SPANS        2000
+
+static panelCalibration calibrations[NUM_PANELS];
+static int failures;
+
+// one channel calibrated on its own: scale by (gain + 1) / 256, add the offset to channels that aren't off, clamp
+static long referenceChannel(long value, int gain, int offset, long maxValue) {
+    if(!value)
+        return 0;
+
+    long calibrated = value * (gain + 1) / 256 + offset;
+    return (calibrated < 0) ? 0 : ((calibrated > maxValue) ? maxValue : calibrated);
+}
+
+template <typename RGB_TEMP>
+static void checkSpan(const char * name, const RGB_TEMP * original, int numPixels, int x, int y) {
+    const long maxValue = (sizeof(RGB_TEMP) <= 3) ? 0xFF : 0xFFFF;
+    const int offsetScale = (sizeof(RGB_TEMP) <= 3) ? 1 : 256;
+    RGB_TEMP pixels[LAYOUT_WIDTH];
+
+    memcpy(pixels, original, sizeof(RGB_TEMP) * numPixels);
+    calibrateHub75Pixels(pixels, numPixels, x, y, calibrations, PANEL_WIDTH, PANEL_HEIGHT, PANELS_PER_ROW);
+
+    for(int i=0; i<numPixels; i++) {
+        const panelCalibration &c = calibrations[(y / PANEL_HEIGHT) * PANELS_PER_ROW + (x + i) / PANEL_WIDTH];
+        long red = referenceChannel(original[i].red, c.redGain, c.offset * offsetScale, maxValue);
+        long green = referenceChannel(original[i].green, c.greenGain, c.offset * offsetScale, maxValue);
+        long blue = referenceChannel(original[i].blue, c.blueGain, c.offset * offsetScale, maxValue);
+
+        if(pixels[i].red != red || pixels[i].green != green || pixels[i].blue != blue) {
+            if(failures < 10)
+                printf("%s: span x %d y %d length %d: pixel %d is (%d,%d,%d), expected (%ld,%ld,%ld)\n", name, x, y, numPixels,
+                    x + i, pixels[i].red, pixels[i].green, pixels[i].blue, red, green, blue);
+            failures++;
+        }
+    }
+}
+
+template <typename RGB_TEMP>
+static void testCalibration(const char * name) {
+    const long maxValue = (sizeof(RGB_TEMP) <= 3) ? 0xFF : 0xFFFF;
+    const panelCalibration none = SM_PANEL_CALIBRATION_NONE;
+    RGB_TEMP row[LAYOUT_WIDTH];
+    int startFailures = failures;
+
+    // panel 0: gain with a positive offset that saturates bright pixels
+    calibrations[0] = (panelCalibration){255, 200, 128, 40};
+    // panel 1: negative offset, clamps dim pixels to 0
+    calibrations[1] = (panelCalibration){240, 255, 255, -60};
+    // panel 2: uncalibrated, must be left untouched
+    calibrations[2] = none;
+    // panel 3: offset only, full scale must stay at full scale
+    calibrations[3] = (panelCalibration){255, 255, 255, 127};
+    // remaining panel rows: random, with one more uncalibrated panel
+    for(int i=PANELS_PER_ROW; i<NUM_PANELS; i++)
+        calibrations[i] = (panelCalibration){(uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand(), (int8_t)rand()};
+    calibrations[PANELS_PER_ROW + 1] = none;
+
+    // full scale and near-black pixels across the whole first panel row, one span crossing every panel boundary
+    for(int i=0; i<LAYOUT_WIDTH; i++) {
+        row[i].red = (i & 1) ? maxValue : 1;
+        row[i].green = (i & 2) ? maxValue : 0;
+        row[i].blue = (i & 4) ? maxValue - 1 : maxValue / 8;
+    }
+    checkSpan(name, row, LAYOUT_WIDTH, 0, 0);
+
+    // spot checks of the cases above, beyond matching the reference
+    RGB_TEMP pixels[LAYOUT_WIDTH];
+    memcpy(pixels, row, sizeof(pixels));
+    calibrateHub75Pixels(pixels, LAYOUT_WIDTH, 0, 0, calibrations, PANEL_WIDTH, PANEL_HEIGHT, PANELS_PER_ROW);
+    for(int i=0; i<LAYOUT_WIDTH; i++) {
+        int panel = i / PANEL_WIDTH;
+        bool ok = true;
+
+        if(panel == 0 && (i & 1) && pixels[i].red != maxValue)
+            ok = false;
+        if(panel == 1 && !(i & 1) && pixels[i].red != 0)
+            ok = false;
+        if(panel == 2 && memcmp(&pixels[i], &row[i], sizeof(RGB_TEMP)))
+            ok = false;
+        if(panel == 3 && (i & 2) && pixels[i].green != maxValue)
+            ok = false;
+        if(!(i & 2) && pixels[i].green != 0)
+            ok = false;
+
+        if(!ok) {
+            if(failures < 10)
+                printf("%s: pixel %d on panel %d is (%d,%d,%d)\n", name, i, panel, pixels[i].red, pixels[i].green, pixels[i].blue);
+            failures++;
+        }
+    }
+
+    // random spans, most of them crossing at least one panel boundary
+    for(int trial=0; trial<RANDOM_SPANS; trial++) {
+        int y = rand() % LAYOUT_HEIGHT;
+        int x = rand() % LAYOUT_WIDTH;
+        int numPixels = 1 + rand() % (LAYOUT_WIDTH - x);
+
+        for(int i=0; i<numPixels; i++) {
+            row[i].red = rand() % (maxValue + 1);
+            row[i].green = rand() % (maxValue + 1);
+            row[i].blue = (i % 5) ? rand() % (maxValue + 1) : 0;
+        }
+        checkSpan(name, row, numPixels, x, y);
+    }
+
+    printf("%s: %d mismatches\n", name, failures - startFailures);
+}
+
+int main(void) {
+    srand(1);
+    testCalibration<rgb24>("rgb24");
+    testCalibration<rgb48>("rgb48");
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return failures ? 1 : 0;
+}
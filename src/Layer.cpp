@@ -21,8 +21,12 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include "Layer.h"
 
+#define CHANGED_ROW_BITMAP_WORDS    ((matrixHeight + 31) / 32)
+
 void SM_Layer::setRotation(rotationDegrees newrotation) {
     layerRotation = newrotation;
 
@@ -46,3 +50,108 @@ int SM_Layer::getRequestedBrightnessShifts() {
 bool SM_Layer::isLayerChanged() {
     return true;
 }
+
+bool SM_Layer::hasRefreshPixels(void) {
+    return false;
+}
+
+void SM_Layer::fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb48 refreshPixels[], int brightnessShifts) {
+}
+
+void SM_Layer::fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb24 refreshPixels[], int brightnessShifts) {
+}
+
+void SM_Layer::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    coverage.drawsPixels = true;
+    coverage.opaqueFirstX = 0;
+    coverage.opaqueEndX = 0;
+}
+
+bool SM_Layer::isLayerRowChanged(uint16_t hardwareY) {
+    if(!refreshRowsChanged || hardwareY >= matrixHeight)
+        return true;
+
+    return refreshRowsChanged[hardwareY / 32] & (1UL << (hardwareY % 32));
+}
+
+// call from begin() after matrixHeight is set, all rows are reported changed for the first frame
+void SM_Layer::beginChangedRowTracking(void) {
+    if(!drawRowsChanged) {
+        drawRowsChanged = (uint32_t *)malloc(sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+        refreshRowsChanged = (uint32_t *)malloc(sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+#ifdef ESP32
+        assert(drawRowsChanged != NULL);
+        assert(refreshRowsChanged != NULL);
+#endif
+    }
+
+    // without both bitmaps, isLayerRowChanged() falls back to reporting every row changed
+    if(!drawRowsChanged || !refreshRowsChanged) {
+        free(drawRowsChanged);
+        free(refreshRowsChanged);
+        drawRowsChanged = NULL;
+        refreshRowsChanged = NULL;
+        return;
+    }
+
+    markAllDrawRowsChanged();
+    markAllRefreshRowsChanged();
+}
+
+// marks hardware rows hardwareY0 through hardwareY1 changed, a bitmap word at a time
+void SM_Layer::markDrawRowsChanged(uint16_t hardwareY0, uint16_t hardwareY1) {
+    if(!drawRowsChanged)
+        return;
+
+    for(int word = hardwareY0 / 32; word <= hardwareY1 / 32; word++) {
+        uint32_t mask = 0xFFFFFFFF;
+        if(word == hardwareY0 / 32)
+            mask &= 0xFFFFFFFF << (hardwareY0 % 32);
+        if(word == hardwareY1 / 32)
+            mask &= 0xFFFFFFFF >> (31 - (hardwareY1 % 32));
+        drawRowsChanged[word] |= mask;
+    }
+}
+
+// use when the drawing buffer is modified in a way that can't be tracked, e.g. through a pointer given to the sketch
+void SM_Layer::markAllDrawRowsChanged(void) {
+    if(drawRowsChanged)
+        memset(drawRowsChanged, 0xFF, sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+}
+
+// use after the refresh buffer is copied to the drawing buffer
+void SM_Layer::clearDrawRowsChanged(void) {
+    if(drawRowsChanged)
+        memset(drawRowsChanged, 0x00, sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+}
+
+// use when a setting that affects every row (e.g. brightness or color correction) changes, takes effect at the next frameRefreshCallback()
+void SM_Layer::markAllRefreshRowsChanged(void) {
+    allRefreshRowsChanged = true;
+}
+
+// call from frameRefreshCallback() before swapping buffers: the rows that differed between the drawing and refresh buffers are the ones that change
+void SM_Layer::updateRefreshRowsChanged(bool bufferSwapped) {
+    if(!refreshRowsChanged)
+        return;
+
+    if(allRefreshRowsChanged) {
+        memset(refreshRowsChanged, 0xFF, sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+        allRefreshRowsChanged = false;
+    } else if(bufferSwapped) {
+        memcpy(refreshRowsChanged, drawRowsChanged, sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+    } else {
+        memset(refreshRowsChanged, 0x00, sizeof(uint32_t) * CHANGED_ROW_BITMAP_WORDS);
+    }
+}
+
+bool SM_Layer::updateColorCorrectionVersion(void) {
+    uint8_t version = SmartMatrixColorCorrection::getVersion();
+
+    if(version == colorCorrectionVersion)
+        return false;
+
+    colorCorrectionVersion = version;
+    markAllRefreshRowsChanged();
+    return true;
+}
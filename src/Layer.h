@@ -26,6 +26,15 @@
 
 #include "MatrixCommon.h"
 
+// how a layer covers one hardware row, see SM_Layer::getRowCoverage()
+typedef struct layerRowCoverage {
+    // false if fillRefreshRow() leaves every pixel in the row unchanged
+    bool drawsPixels;
+    // fillRefreshRow() overwrites every pixel from opaqueFirstX to opaqueEndX - 1, no pixels are covered if opaqueFirstX >= opaqueEndX
+    uint16_t opaqueFirstX;
+    uint16_t opaqueEndX;
+} layerRowCoverage;
+
 class SM_Layer {
     public:
         virtual void begin() = 0;
@@ -35,6 +44,18 @@ class SM_Layer {
         virtual void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0) = 0;
         virtual void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0) = 0;
 
+        // optional fast path for a layer that is the only one in the chain: fills refreshPixels with the numPixels values fillRefreshRow()
+        // would write starting at hardwareX, so the calc doesn't need to stage full rows.  Layers that return true from
+        // hasRefreshPixels() must overwrite every pixel (transparent pixels aren't supported)
+        virtual bool hasRefreshPixels(void);
+        virtual void fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb48 refreshPixels[], int brightnessShifts = 0);
+        virtual void fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb24 refreshPixels[], int brightnessShifts = 0);
+
+        // optional row coverage for compositing layers top-down, valid after frameRefreshCallback(): layers under an opaque span only fill
+        // the pixels left uncovered (if they have fillRefreshPixels()), and are skipped when the whole row is covered.  The default
+        // reports a layer that may draw any pixel and covers none
+        virtual void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
+
         virtual void setRotation(rotationDegrees newrotation);
         rotationDegrees getLayerRotation(void) const { return layerRotation; };
         uint16_t getLayerWidth(void) const { return layerWidth; };
@@ -44,6 +65,9 @@ class SM_Layer {
         virtual void setRefreshRate(uint8_t newRefreshRate);
         virtual int getRequestedBrightnessShifts();
         virtual bool isLayerChanged();
+        // after frameRefreshCallback(), returns false if hardware row hardwareY is unchanged from the previous frame
+        // layers that don't call beginChangedRowTracking() return true for every row
+        virtual bool isLayerRowChanged(uint16_t hardwareY);
 
         SM_Layer * nextLayer;
 
@@ -57,6 +81,26 @@ class SM_Layer {
         // the local dimensions of this layer with rotation applied, local x=0,y=0 in the upper left
         uint16_t localWidth, localHeight;
         uint8_t refreshRate;
+
+        // changed row tracking, for layers that know which rows their drawing functions modify
+        void beginChangedRowTracking(void);
+        void markDrawRowChanged(uint16_t hardwareY) { if(drawRowsChanged) drawRowsChanged[hardwareY / 32] |= (1UL << (hardwareY % 32)); };
+        void markDrawRowsChanged(uint16_t hardwareY0, uint16_t hardwareY1);
+        void markAllDrawRowsChanged(void);
+        void clearDrawRowsChanged(void);
+        void markAllRefreshRowsChanged(void);
+        void updateRefreshRowsChanged(bool bufferSwapped);
+
+        // bitmaps with one bit per hardware row: rows where the drawing buffer may differ from the refresh buffer,
+        // and rows that changed in the refresh buffer during the last frameRefreshCallback()
+        uint32_t * drawRowsChanged = NULL;
+        uint32_t * refreshRowsChanged = NULL;
+        volatile bool allRefreshRowsChanged = false;
+
+        // call at the start of frameRefreshCallback(): returns true and marks every row changed when SmartMatrixColorCorrection's
+        // curves changed since the last call
+        bool updateColorCorrectionVersion(void);
+        uint8_t colorCorrectionVersion = 0;
         
     private:
 };
@@ -30,6 +30,19 @@
 
 #define SM_BACKGROUND_OPTIONS_NONE     0
 
+// largest brightnessShifts accepted by fillRefreshRow(), see setBrightnessShifts()
+#define SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS     4
+
+// swapBuffers(true) copies the whole buffer instead of just the changed pixels when more than 1/SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION of the buffer changed
+#ifndef SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION
+#define SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION    2
+#endif
+
+// blitRect() transposes rotation90/270 blocks in tiles of this many pixels square
+#ifndef SM_BACKGROUND_BLIT_TILE_SIZE
+#define SM_BACKGROUND_BLIT_TILE_SIZE    8
+#endif
+
 template <typename RGB, unsigned int optionFlags>
 class SMLayerBackground : public SM_Layer {
     public:
@@ -39,6 +52,10 @@ class SMLayerBackground : public SM_Layer {
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        bool hasRefreshPixels(void);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
+        void fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb48 refreshPixels[], int brightnessShifts = 0);
+        void fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb24 refreshPixels[], int brightnessShifts = 0);
         int getRequestedBrightnessShifts();
         bool isLayerChanged();
         
@@ -71,6 +88,13 @@ class SMLayerBackground : public SM_Layer {
         void drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]);
         void drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]);
         void drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, const RGB& bitmapColor, const uint8_t *bitmap);
+        // copies a block of rgb16/rgb24/rgb48 or RGB565 pixels, bitmapStride is in pixels, 0 if the bitmap rows are packed
+        template <typename RGB_IN>
+        void blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap, uint16_t bitmapStride = 0);
+        void blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap, uint16_t bitmapStride = 0);
+        template <typename RGB_IN>
+        void drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap);
+        void drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap);
 
         // reads pixel from drawing buffer, not refresh buffer
         const RGB readPixel(int16_t x, int16_t y);
@@ -105,8 +129,31 @@ class SMLayerBackground : public SM_Layer {
         void bresteepline(int16_t x3, int16_t y3, int16_t x4, int16_t y4, const RGB& color);
         void fillFlatSideTriangleInt(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& color);
 
+        // fillRefreshPixels() kernels, specialized for color correction and brightnessShifts so the inner loop has no branches or variable shifts
+        typedef void (*fillRefreshKernel48)(const RGB * src, uint16_t numPixels, rgb48 refreshPixels[], const color_chan_t * const luts[3]);
+        typedef void (*fillRefreshKernel24)(const RGB * src, uint16_t numPixels, rgb24 refreshPixels[], const color_chan_t * const luts[3]);
+        template <bool colorCorrection, int brightnessShifts, typename RGB_OUT>
+        static void fillRefreshKernel(const RGB * src, uint16_t numPixels, RGB_OUT refreshPixels[], const color_chan_t * const luts[3]);
+        template <bool colorCorrection, int brightnessShifts>
+        static rgb48 getRefreshPixel(const RGB &pixel, const color_chan_t * redLUT, const color_chan_t * greenLUT, const color_chan_t * blueLUT);
+        template <int brightnessShifts, typename LANE>
+        static void shiftRefreshLanes(const RGB * src, uint16_t numPixels, void * refreshPixels);
+
+        // kernels indexed by [ccEnabled][brightnessShifts]
+        static const fillRefreshKernel48 fillRefreshKernels48[2][SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS + 1];
+        static const fillRefreshKernel24 fillRefreshKernels24[2][SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS + 1];
+        // kernels for the current frame, indexed by brightnessShifts, chosen in frameRefreshCallback()
+        const fillRefreshKernel48 * currentFillRefreshKernels48 = fillRefreshKernels48[1];
+        const fillRefreshKernel24 * currentFillRefreshKernels24 = fillRefreshKernels24[1];
+
         uint8_t backgroundBrightness = 255;
+        // LUTs are recalculated when the brightness or color correction curves change.  backgroundColorCorrectionLUT is used for
+        // all channels, or just red once SmartMatrixColorCorrection allocates backgroundChannelLUTs for different channel gains
         color_chan_t * backgroundColorCorrectionLUT;
+        color_chan_t * backgroundChannelLUTs = NULL;
+        // red, green and blue LUTs for the current frame
+        const color_chan_t * currentLUTs[3];
+        int lutBrightness = -1;
         bitmap_font *font;
 
         // idealBrightnessShifts is the number of shifts towards MSB the pixel data can handle without overflowing
@@ -114,6 +161,16 @@ class SMLayerBackground : public SM_Layer {
         // pendingIdealBrightnessShifts keeps track of the data queued up with swapBuffers()
         int pendingIdealBrightnessShifts = 0;
 
+        // span of hardware columns in each row written since the drawing buffer last matched the refresh buffer
+        void markDrawPixelsChanged(uint16_t hwx0, uint16_t hwx1, uint16_t hwy);
+        void markDrawColumnChanged(uint16_t hwx, uint16_t hwy0, uint16_t hwy1);
+        void markAllDrawPixelsChanged(void);
+        void clearDrawPixelsChanged(void);
+        void copyChangedDrawPixels(RGB * drawBuffer, const RGB * refreshBuffer);
+        uint16_t * drawPixelsChangedFirstX = NULL;
+        uint16_t * drawPixelsChangedEndX = NULL;
+        bool allDrawPixelsChanged = true;
+
         // keeping track of drawing buffers
         volatile unsigned char currentDrawBuffer;
         volatile unsigned char currentRefreshBuffer;
@@ -33,6 +33,16 @@
 
 #define SM_BACKGROUND_GFX_OPTIONS_NONE     0
 
+// swapBuffers(true) copies the whole buffer instead of just the changed pixels when more than 1/SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION of the buffer changed
+#ifndef SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION
+#define SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION    2
+#endif
+
+// blitRect() transposes rotation90/270 blocks in tiles of this many pixels square
+#ifndef SM_BACKGROUND_BLIT_TILE_SIZE
+#define SM_BACKGROUND_BLIT_TILE_SIZE    8
+#endif
+
 #define SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
 //#define SM_BACKGROUND_GFX_OLD_DRAWING_FUNCTIONS
 
@@ -46,6 +56,7 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
         void copyRefreshToDrawing(void);
 
         // could make this generic if moving the buffer copy code to a new function
@@ -53,9 +64,20 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
 
         /* RGB Specific Core Drawing Methods */
         void drawPixel(int16_t x, int16_t y, const RGB& color);
+        // copies a block of rgb16/rgb24/rgb48 or RGB565 pixels, bitmapStride is in pixels, 0 if the bitmap rows are packed
+        template <typename RGB_IN>
+        void blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap, uint16_t bitmapStride = 0);
+        void blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap, uint16_t bitmapStride = 0);
+        template <typename RGB_IN>
+        void drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap);
+        void drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap);
 
         /* RGB Specific Adafruit_GFX methods */
         void drawPixel(int16_t x, int16_t y, uint16_t color);
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void fillScreen(uint16_t color);
 
         /* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
 #ifdef SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
@@ -120,6 +142,7 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         using Adafruit_GFX::fillScreen;
         using Adafruit_GFX::drawFastVLine;
         using Adafruit_GFX::drawFastHLine;
+        using Adafruit_GFX::drawBitmap;
 
     protected:
         // Note we'd use a function template for the public functions but are keeping them fixed with rgb24/rgb48 parameters for backwards compatibility
@@ -129,6 +152,7 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         // drawing functions not meant for user
         void drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color);
         void drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color);
+        void fillRotatedRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
 
         bool ccEnabled = true;
 
@@ -153,7 +177,13 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
 #endif
 
         uint8_t backgroundBrightness = 255;
+        // LUTs are recalculated when the brightness or color correction curves change.  backgroundColorCorrectionLUT is used for
+        // all channels, or just red once SmartMatrixColorCorrection allocates backgroundChannelLUTs for different channel gains
         color_chan_t * backgroundColorCorrectionLUT;
+        color_chan_t * backgroundChannelLUTs = NULL;
+        // red, green and blue LUTs for the current frame
+        const color_chan_t * currentLUTs[3];
+        int lutBrightness = -1;
 
         int16_t layerXOffset = 0;
         int16_t layerYOffset = 0;
@@ -163,6 +193,16 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         // pendingIdealBrightnessShifts keeps track of the data queued up with swapBuffers()
         int pendingIdealBrightnessShifts = 0;
 
+        // span of hardware columns in each row written since the drawing buffer last matched the refresh buffer
+        void markDrawPixelsChanged(uint16_t hwx0, uint16_t hwx1, uint16_t hwy);
+        void markDrawColumnChanged(uint16_t hwx, uint16_t hwy0, uint16_t hwy1);
+        void markAllDrawPixelsChanged(void);
+        void clearDrawPixelsChanged(void);
+        void copyChangedDrawPixels(RGB * drawBuffer, const RGB * refreshBuffer);
+        uint16_t * drawPixelsChangedFirstX = NULL;
+        uint16_t * drawPixelsChangedEndX = NULL;
+        bool allDrawPixelsChanged = true;
+
         // keeping track of drawing buffers
         volatile unsigned char currentDrawBuffer;
         volatile unsigned char currentRefreshBuffer;
@@ -85,12 +85,38 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::begin(void) {
 
     currentDrawBufferPtr = backgroundBuffers[0];
     currentRefreshBufferPtr = backgroundBuffers[1];
+
+    // without the changed pixel spans, swapBuffers(true) falls back to copying the whole buffer
+    if(!drawPixelsChangedFirstX) {
+        drawPixelsChangedFirstX = (uint16_t *)malloc(sizeof(uint16_t) * this->matrixHeight);
+        drawPixelsChangedEndX = (uint16_t *)malloc(sizeof(uint16_t) * this->matrixHeight);
+
+        if(!drawPixelsChangedFirstX || !drawPixelsChangedEndX) {
+            free(drawPixelsChangedFirstX);
+            free(drawPixelsChangedEndX);
+            drawPixelsChangedFirstX = NULL;
+            drawPixelsChangedEndX = NULL;
+        }
+    }
+    clearDrawPixelsChanged();
+    allDrawPixelsChanged = true;
+
+    // a single LUT until the color correction has different channel gains, frameRefreshCallback() fills them
+    for(int i=0; i<3; i++)
+        currentLUTs[i] = backgroundColorCorrectionLUT;
+    SmartMatrixColorCorrection::addBackgroundChannelLUTs(&backgroundChannelLUTs, (sizeof(RGB) <= 3) ? 8 : 12);
+
+    this->beginChangedRowTracking();
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::handleBufferSwap(void) {
-    if (!swapPending)
+    if (!swapPending) {
+        this->updateRefreshRowsChanged(false);
         return;
+    }
+
+    this->updateRefreshRowsChanged(true);
 
     unsigned char newDrawBuffer = currentRefreshBuffer;
 
@@ -105,12 +131,19 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::handleBufferSwap(void) {
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::frameRefreshCallback(void) {
+    bool correctionChanged = this->updateColorCorrectionVersion();
+    uint8_t brightness = backgroundBrightness;
+
     handleBufferSwap();
 
-    if(sizeof(RGB) > 3)
-        calculate12BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
-    else
-        calculate8BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+    if(correctionChanged || brightness != lutBrightness) {
+        lutBrightness = brightness;
+
+        if(sizeof(RGB) > 3)
+            calculate12BitBackgroundLUT(currentLUTs, backgroundColorCorrectionLUT, backgroundChannelLUTs, brightness);
+        else
+            calculate8BitBackgroundLUT(currentLUTs, backgroundColorCorrectionLUT, backgroundChannelLUTs, brightness);
+    }
 }
 
 template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
@@ -136,19 +169,23 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t ha
     }
 
     if(this->ccEnabled) {
+        const color_chan_t * redLUT = currentLUTs[0];
+        const color_chan_t * greenLUT = currentLUTs[1];
+        const color_chan_t * blueLUT = currentLUTs[2];
+
         for(i=iRangeMin; i<iRangeMax; i++) {
             currentPixel = *ptr++;
             // load background pixel with color correction
             if(sizeof(RGB) <= 3) {
                 // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
+                refreshRow[i] = rgb48(redLUT[currentPixel.red << brightnessShifts],
+                    greenLUT[currentPixel.green << brightnessShifts],
+                    blueLUT[currentPixel.blue << brightnessShifts]);                
             } else {
                 // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
+                refreshRow[i] = rgb48(redLUT[currentPixel.red >> (4 - brightnessShifts)],
+                    greenLUT[currentPixel.green >> (4 - brightnessShifts)],
+                    blueLUT[currentPixel.blue >> (4 - brightnessShifts)]);
             }
         }
     } else {
@@ -170,6 +207,20 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t ha
     }
 }
 
+// every pixel of the layer is opaque, rows are covered over the range fillRefreshRowTemplated() writes
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    int16_t iRangeMin = (layerXOffset > 0) ? layerXOffset : 0;
+    int16_t iRangeMax = (layerXOffset < 0) ? this->matrixWidth + layerXOffset : this->matrixWidth;
+
+    coverage.drawsPixels = (((hardwareY - layerYOffset) <= (this->matrixHeight - 1)) && ((hardwareY - layerYOffset) >= 0));
+    coverage.opaqueFirstX = iRangeMin;
+    coverage.opaqueEndX = iRangeMin;
+
+    if(coverage.drawsPixels && iRangeMax > iRangeMin)
+        coverage.opaqueEndX = iRangeMax;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
     fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
@@ -182,7 +233,8 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY,
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::copyRefreshToDrawing() {
-    memcpy((void *)currentDrawBufferPtr, (void *)currentRefreshBufferPtr, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+    copyChangedDrawPixels(currentDrawBufferPtr, currentRefreshBufferPtr);
+    clearDrawPixelsChanged();
 }
 
 // waits until previous swap is complete
@@ -197,10 +249,14 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::swapBuffers(bool copy) {
         while (swapPending);
 #if 1
         // workaround for bizarre (optimization) bug - currentDrawBuffer and currentRefreshBuffer are volatile and are changed by an ISR while we're waiting for swapPending here.  They can't be used as parameters to memcpy directly though.  
+        // only the pixels drawn since the last copy differ between the buffers
         if(currentDrawBuffer)
-            memcpy((void *)backgroundBuffers[1], (void *)backgroundBuffers[0], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+            copyChangedDrawPixels(backgroundBuffers[1], backgroundBuffers[0]);
         else
-            memcpy((void *)backgroundBuffers[0], (void *)backgroundBuffers[1], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+            copyChangedDrawPixels(backgroundBuffers[0], backgroundBuffers[1]);
+
+        // drawing buffer now matches the refresh buffer
+        clearDrawPixelsChanged();
 #else
         // Similar code also drawing from volatile variables doesn't work if optimization is turned on: currentDrawBuffer will be equal to currentRefreshBuffer and cause a crash from memcpy copying a buffer to itself.  Why?
         memcpy((void *)backgroundBuffers[currentDrawBuffer], (void *)backgroundBuffers[currentRefreshBuffer], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
@@ -217,9 +273,86 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::swapBuffers(bool copy) {
 
 /* RGB Specific Core Drawing Methods */
 
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackgroundGFX<RGB, optionFlags>::markDrawPixelsChanged(uint16_t hwx0, uint16_t hwx1, uint16_t hwy) {
+    this->markDrawRowChanged(hwy);
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    if(hwx0 < drawPixelsChangedFirstX[hwy])
+        drawPixelsChangedFirstX[hwy] = hwx0;
+    if(hwx1 >= drawPixelsChangedEndX[hwy])
+        drawPixelsChangedEndX[hwy] = hwx1 + 1;
+}
+
+// marks column hwx changed in rows hwy0 through hwy1
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::markDrawColumnChanged(uint16_t hwx, uint16_t hwy0, uint16_t hwy1) {
+    this->markDrawRowsChanged(hwy0, hwy1);
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    for(int i = hwy0; i <= hwy1; i++) {
+        if(hwx < drawPixelsChangedFirstX[i])
+            drawPixelsChangedFirstX[i] = hwx;
+        if(hwx >= drawPixelsChangedEndX[i])
+            drawPixelsChangedEndX[i] = hwx + 1;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::markAllDrawPixelsChanged(void) {
+    this->markAllDrawRowsChanged();
+    allDrawPixelsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::clearDrawPixelsChanged(void) {
+    this->clearDrawRowsChanged();
+    allDrawPixelsChanged = false;
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    for(int i=0; i<this->matrixHeight; i++) {
+        drawPixelsChangedFirstX[i] = this->matrixWidth;
+        drawPixelsChangedEndX[i] = 0;
+    }
+}
+
+// copies only the pixels drawn since the buffers last matched, or the whole buffer if enough changed that row by row copies aren't worth it
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::copyChangedDrawPixels(RGB * drawBuffer, const RGB * refreshBuffer) {
+    uint32_t bufferPixels = this->matrixWidth * this->matrixHeight;
+    uint32_t changedPixels = bufferPixels;
+
+    if(!allDrawPixelsChanged && drawPixelsChangedFirstX) {
+        changedPixels = 0;
+        for(int i=0; i<this->matrixHeight; i++) {
+            if(drawPixelsChangedEndX[i] > drawPixelsChangedFirstX[i])
+                changedPixels += drawPixelsChangedEndX[i] - drawPixelsChangedFirstX[i];
+        }
+    }
+
+    if(changedPixels > bufferPixels / SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION) {
+        memcpy((void *)drawBuffer, (void *)refreshBuffer, sizeof(RGB) * bufferPixels);
+        return;
+    }
+
+    for(int i=0; i<this->matrixHeight; i++) {
+        if(drawPixelsChangedEndX[i] > drawPixelsChangedFirstX[i]) {
+            int offset = (i * this->matrixWidth) + drawPixelsChangedFirstX[i];
+            memcpy((void *)&drawBuffer[offset], (void *)&refreshBuffer[offset], sizeof(RGB) * (drawPixelsChangedEndX[i] - drawPixelsChangedFirstX[i]));
+        }
+    }
+}
+
 template <typename RGB, unsigned int optionFlags>
 INLINE void SMLayerBackgroundGFX<RGB, optionFlags>::loadPixelToDrawBuffer(int16_t hwx, int16_t hwy, const RGB& color) {
     currentDrawBufferPtr[(hwy * this->matrixWidth) + hwx] = color;
+    markDrawPixelsChanged(hwx, hwx, hwy);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -259,28 +392,242 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uin
         drawPixel(x, y, (rgb16)color);
 }
 
-/* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
+// Adafruit_GFX fills (fillScreen, fillRect, fillCircle, fillRoundRect, fillTriangle) end up here instead of going through drawPixel() one pixel at a time
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    // like the Adafruit_GFX display drivers, a negative width or height extends left or up from x,y
+    if (w < 0) {
+        x += w + 1;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h + 1;
+        h = -h;
+    }
+    if (!w || !h)
+        return;
 
-#ifdef SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
+    if(passThruColorFlag)
+        fillRotatedRectangle(x, y, x + w - 1, y + h - 1, passThruColor);
+    else
+        fillRotatedRectangle(x, y, x + w - 1, y + h - 1, (rgb16)color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fillRect(x, y, w, 1, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fillRect(x, y, 1, h, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillScreen(uint16_t color) {
+    fillRect(0, 0, this->localWidth, this->localHeight, color);
+}
+
+/* RGB Specific Span Fills */
 
 // x0, x1, and y must be in bounds (0-this->localWidth/Height-1), x1 > x0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color) {
-    int i;
-
-    for (i = x0; i <= x1; i++) {
-        loadPixelToDrawBuffer(i, y, color);
-    }
+    fillColorSpan(&currentDrawBufferPtr[(y * this->matrixWidth) + x0], x1 - x0 + 1, color);
+    markDrawPixelsChanged(x0, x1, y);
 }
 
 // x, y0, and y1 must be in bounds (0-this->localWidth/Height-1), y1 > y0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color) {
     int i;
+    RGB * pixel = &currentDrawBufferPtr[(y0 * this->matrixWidth) + x];
 
     for (i = y0; i <= y1; i++) {
-        loadPixelToDrawBuffer(x, i, color);
+        *pixel = color;
+        pixel += this->matrixWidth;
     }
+    markDrawColumnChanged(x, y0, y1);
+}
+
+// x0, y0, x1, y1 are in local coordinates and are clipped to the layer
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillRotatedRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    int i;
+    int16_t hwx0, hwy0, hwx1, hwy1;
+
+    // Loop only works if y1 > y0
+    if (y0 > y1) {
+        SWAPint(y0, y1);
+    };
+    if (x0 > x1) {
+        SWAPint(x0, x1);
+    };
+
+    // check for completely out of bounds rectangle
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    // the rectangle is still a rectangle in hardware coordinates, map it once and fill it a hardware row at a time
+    if (this->layerRotation == rotation0) {
+        hwx0 = x0;
+        hwx1 = x1;
+        hwy0 = y0;
+        hwy1 = y1;
+    } else if (this->layerRotation == rotation180) {
+        hwx0 = (this->matrixWidth - 1) - x1;
+        hwx1 = (this->matrixWidth - 1) - x0;
+        hwy0 = (this->matrixHeight - 1) - y1;
+        hwy1 = (this->matrixHeight - 1) - y0;
+    } else if (this->layerRotation == rotation90) {
+        hwx0 = (this->matrixWidth - 1) - y1;
+        hwx1 = (this->matrixWidth - 1) - y0;
+        hwy0 = x0;
+        hwy1 = x1;
+    } else { /* if (layerRotation == rotation270)*/
+        hwx0 = y0;
+        hwx1 = y1;
+        hwy0 = (this->matrixHeight - 1) - x1;
+        hwy1 = (this->matrixHeight - 1) - x0;
+    }
+
+    for (i = hwy0; i <= hwy1; i++) {
+        drawHardwareHLine(hwx0, hwx1, i, color);
+    }
+}
+
+/* RGB Specific Bitmap Copies */
+
+// copies a width x height block of pixels to x,y, clipping the block to the layer once
+// bitmapStride is the number of pixels from the start of one bitmap row to the next, 0 if the rows are packed
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_IN>
+void SMLayerBackgroundGFX<RGB, optionFlags>::blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap, uint16_t bitmapStride) {
+    int i, j, tileX, tileY;
+    int x0 = x, y0 = y, x1 = x + width - 1, y1 = y + height - 1;
+    int hwx0, hwy0, hwx1, hwy1;
+    int rowStep, pixelStep;
+    RGB * pixel;
+    RGB * firstPixel;
+
+    if (!bitmapStride)
+        bitmapStride = width;
+
+    // check for empty or completely out of bounds block
+    if (width <= 0 || height <= 0 || x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds, moving the start of the bitmap to match
+    if (x0 < 0) {
+        bitmap += -x0;
+        x0 = 0;
+    }
+    if (y0 < 0) {
+        bitmap += -y0 * bitmapStride;
+        y0 = 0;
+    }
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    width = x1 - x0 + 1;
+    height = y1 - y0 + 1;
+
+    if (this->layerRotation == rotation0) {
+        hwx0 = x0;
+        hwx1 = x1;
+        hwy0 = y0;
+        hwy1 = y1;
+
+        for (j = 0; j < height; j++)
+            copyColorSpan(&currentDrawBufferPtr[((hwy0 + j) * this->matrixWidth) + hwx0], &bitmap[j * bitmapStride], width);
+    } else if (this->layerRotation == rotation180) {
+        hwx0 = (this->matrixWidth - 1) - x1;
+        hwx1 = (this->matrixWidth - 1) - x0;
+        hwy0 = (this->matrixHeight - 1) - y1;
+        hwy1 = (this->matrixHeight - 1) - y0;
+
+        // each bitmap row is a hardware row in reverse order
+        for (j = 0; j < height; j++) {
+            pixel = &currentDrawBufferPtr[((hwy1 - j) * this->matrixWidth) + hwx1];
+            for (i = 0; i < width; i++)
+                *pixel-- = bitmap[(j * bitmapStride) + i];
+        }
+    } else {
+        // each bitmap column is a hardware row, transpose a tile at a time so neither the bitmap or the buffer is walked a full column at a time
+        if (this->layerRotation == rotation90) {
+            hwx0 = (this->matrixWidth - 1) - y1;
+            hwx1 = (this->matrixWidth - 1) - y0;
+            hwy0 = x0;
+            hwy1 = x1;
+
+            firstPixel = &currentDrawBufferPtr[(hwy0 * this->matrixWidth) + hwx1];
+            rowStep = this->matrixWidth;
+            pixelStep = -1;
+        } else { /* if (layerRotation == rotation270)*/
+            hwx0 = y0;
+            hwx1 = y1;
+            hwy0 = (this->matrixHeight - 1) - x1;
+            hwy1 = (this->matrixHeight - 1) - x0;
+
+            firstPixel = &currentDrawBufferPtr[(hwy1 * this->matrixWidth) + hwx0];
+            rowStep = -this->matrixWidth;
+            pixelStep = 1;
+        }
+
+        for (tileY = 0; tileY < height; tileY += SM_BACKGROUND_BLIT_TILE_SIZE) {
+            for (tileX = 0; tileX < width; tileX += SM_BACKGROUND_BLIT_TILE_SIZE) {
+                for (i = tileX; i < min(tileX + SM_BACKGROUND_BLIT_TILE_SIZE, width); i++) {
+                    pixel = firstPixel + (i * rowStep) + (tileY * pixelStep);
+
+                    for (j = tileY; j < min(tileY + SM_BACKGROUND_BLIT_TILE_SIZE, height); j++) {
+                        *pixel = bitmap[(j * bitmapStride) + i];
+                        pixel += pixelStep;
+                    }
+                }
+            }
+        }
+    }
+
+    for (j = hwy0; j <= hwy1; j++)
+        markDrawPixelsChanged(hwx0, hwx1, j);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap, uint16_t bitmapStride) {
+    // rgb16 has the same layout as a RGB565 uint16_t
+    blitRect(x, y, width, height, (const rgb16 *)bitmap, bitmapStride);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_IN>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap) {
+    blitRect(x, y, width, height, bitmap, 0);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap) {
+    blitRect(x, y, width, height, bitmap, 0);
+}
+
+/* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
+
+#ifdef SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    fillRotatedRectangle(x0, y0, x1, y1, color);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -341,23 +688,6 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0
     }
 }
 
-template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
-    int i;
-    // Loop only works if y1 > y0
-    if (y0 > y1) {
-        SWAPint(y0, y1);
-    };
-    // Putting the x coordinates in order saves multiple swaps in drawFastHLine
-    if (x0 > x1) {
-        SWAPint(x0, x1);
-    };
-
-    for (i = y0; i <= y1; i++) {
-        drawFastHLine(x0, x1, i, color);
-    }
-}
-
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::fillScreen(const RGB& color) {
     fillRectangle(0, 0, this->localWidth - 1, this->localHeight - 1, color);
@@ -402,17 +732,21 @@ const RGB SMLayerBackgroundGFX<RGB, optionFlags>::readPixel(int16_t x, int16_t y
 // return pointer to start of currentDrawBuffer, so application can do efficient loading of bitmaps
 template <typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackgroundGFX<RGB, optionFlags>::backBuffer(void) {
+    // the sketch can write anywhere in the buffer
+    markAllDrawPixelsChanged();
     return currentDrawBufferPtr;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::setBackBuffer(RGB *newBuffer) {
   currentDrawBufferPtr = newBuffer;
+  markAllDrawPixelsChanged();
 }
 
 
 template<typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackgroundGFX<RGB, optionFlags>::getRealBackBuffer() {
+  markAllDrawPixelsChanged();
   return backgroundBuffers[currentDrawBuffer];
 }
 
@@ -441,11 +775,17 @@ bool SMLayerBackgroundGFX<RGB, optionFlags>::isSwapPending(void) {
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::setBrightness(uint8_t brightness) {
+    if(brightness != backgroundBrightness)
+        this->markAllRefreshRowsChanged();
+
     backgroundBrightness = brightness;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    if(enabled != this->ccEnabled)
+        this->markAllRefreshRowsChanged();
+
     this->ccEnabled = enabled;
 }
 
@@ -78,16 +78,49 @@ void SMLayerBackground<RGB, optionFlags>::begin(void) {
 
     currentDrawBufferPtr = backgroundBuffers[0];
     currentRefreshBufferPtr = backgroundBuffers[1];
+
+    // without the changed pixel spans, swapBuffers(true) falls back to copying the whole buffer
+    if(!drawPixelsChangedFirstX) {
+        drawPixelsChangedFirstX = (uint16_t *)malloc(sizeof(uint16_t) * this->matrixHeight);
+        drawPixelsChangedEndX = (uint16_t *)malloc(sizeof(uint16_t) * this->matrixHeight);
+
+        if(!drawPixelsChangedFirstX || !drawPixelsChangedEndX) {
+            free(drawPixelsChangedFirstX);
+            free(drawPixelsChangedEndX);
+            drawPixelsChangedFirstX = NULL;
+            drawPixelsChangedEndX = NULL;
+        }
+    }
+    clearDrawPixelsChanged();
+    allDrawPixelsChanged = true;
+
+    // a single LUT until the color correction has different channel gains, frameRefreshCallback() fills them
+    for(int i=0; i<3; i++)
+        currentLUTs[i] = backgroundColorCorrectionLUT;
+    SmartMatrixColorCorrection::addBackgroundChannelLUTs(&backgroundChannelLUTs, (sizeof(RGB) <= 3) ? 8 : 12);
+
+    this->beginChangedRowTracking();
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::frameRefreshCallback(void) {
+    bool correctionChanged = this->updateColorCorrectionVersion();
+    uint8_t brightness = backgroundBrightness;
+
     handleBufferSwap();
 
-    if(sizeof(RGB) > 3)
-        calculate12BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
-    else
-        calculate8BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+    if(correctionChanged || brightness != lutBrightness) {
+        lutBrightness = brightness;
+
+        if(sizeof(RGB) > 3)
+            calculate12BitBackgroundLUT(currentLUTs, backgroundColorCorrectionLUT, backgroundChannelLUTs, brightness);
+        else
+            calculate8BitBackgroundLUT(currentLUTs, backgroundColorCorrectionLUT, backgroundChannelLUTs, brightness);
+    }
+
+    // choose the fillRefreshPixels() kernels once per frame, so enableColorCorrection() doesn't change them partway through a frame
+    currentFillRefreshKernels48 = fillRefreshKernels48[this->ccEnabled ? 1 : 0];
+    currentFillRefreshKernels24 = fillRefreshKernels24[this->ccEnabled ? 1 : 0];
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -106,85 +139,132 @@ void SMLayerBackground<RGB, optionFlags>::setBrightnessShifts(int numShifts) {
     pendingIdealBrightnessShifts = numShifts;
 }
 
+// the background layer is opaque, so when it's the only layer the calc can skip the temporary rows and fill blocks of pixels directly
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::hasRefreshPixels(void) {
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    coverage.drawsPixels = true;
+    coverage.opaqueFirstX = 0;
+    coverage.opaqueEndX = this->matrixWidth;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
-    int i;
+    fillRefreshPixels(0, hardwareY, this->matrixWidth, refreshRow, brightnessShifts);
+}
 
-    RGB *ptr = currentRefreshBufferPtr + (hardwareY * this->matrixWidth);
-
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            currentPixel = *ptr++;
-            // load background pixel with color correction
-            if(sizeof(RGB) <= 3) {
-                // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
-            } else {
-                // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
-            }
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            currentPixel = *ptr++;
-            // load background pixel without color correction
-            if(sizeof(RGB) <= 3) {
-                // 24-bit source (8 bits per color channel): shift to fit in 16-bit color channel
-                refreshRow[i] = rgb48(currentPixel.red << (brightnessShifts + 8),
-                    currentPixel.green << (brightnessShifts + 8),
-                    currentPixel.blue << (brightnessShifts + 8));
-            } else {
-                // 48-bit source (16 bits per color channel): no shifting needed to fit in 16-bit color channel
-                refreshRow[i] = rgb48(currentPixel.red << brightnessShifts,
-                    currentPixel.green << brightnessShifts,
-                    currentPixel.blue << brightnessShifts);                
-            }
-        }
-    }
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb48 refreshPixels[], int brightnessShifts) {
+    if(brightnessShifts > SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS)
+        brightnessShifts = SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS;
+
+    currentFillRefreshKernels48[brightnessShifts](currentRefreshBufferPtr + (hardwareY * this->matrixWidth) + hardwareX, numPixels, refreshPixels, currentLUTs);
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
-    int i;
+    fillRefreshPixels(0, hardwareY, this->matrixWidth, refreshRow, brightnessShifts);
+}
 
-    RGB *ptr = currentRefreshBufferPtr + (hardwareY * this->matrixWidth);
-
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            currentPixel = *ptr++;
-            // load background pixel with color correction
-            if(sizeof(RGB) <= 3) {
-                // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
-            } else {
-                // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
-            }
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillRefreshPixels(uint16_t hardwareX, uint16_t hardwareY, uint16_t numPixels, rgb24 refreshPixels[], int brightnessShifts) {
+    if(brightnessShifts > SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS)
+        brightnessShifts = SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS;
+
+    currentFillRefreshKernels24[brightnessShifts](currentRefreshBufferPtr + (hardwareY * this->matrixWidth) + hardwareX, numPixels, refreshPixels, currentLUTs);
+}
+
+template <typename RGB, unsigned int optionFlags>
+const typename SMLayerBackground<RGB, optionFlags>::fillRefreshKernel48 SMLayerBackground<RGB, optionFlags>::fillRefreshKernels48[2][SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS + 1] = {
+    { fillRefreshKernel<false, 0, rgb48>, fillRefreshKernel<false, 1, rgb48>, fillRefreshKernel<false, 2, rgb48>, fillRefreshKernel<false, 3, rgb48>, fillRefreshKernel<false, 4, rgb48> },
+    { fillRefreshKernel<true, 0, rgb48>, fillRefreshKernel<true, 1, rgb48>, fillRefreshKernel<true, 2, rgb48>, fillRefreshKernel<true, 3, rgb48>, fillRefreshKernel<true, 4, rgb48> }
+};
+
+template <typename RGB, unsigned int optionFlags>
+const typename SMLayerBackground<RGB, optionFlags>::fillRefreshKernel24 SMLayerBackground<RGB, optionFlags>::fillRefreshKernels24[2][SM_BACKGROUND_MAX_BRIGHTNESS_SHIFTS + 1] = {
+    { fillRefreshKernel<false, 0, rgb24>, fillRefreshKernel<false, 1, rgb24>, fillRefreshKernel<false, 2, rgb24>, fillRefreshKernel<false, 3, rgb24>, fillRefreshKernel<false, 4, rgb24> },
+    { fillRefreshKernel<true, 0, rgb24>, fillRefreshKernel<true, 1, rgb24>, fillRefreshKernel<true, 2, rgb24>, fillRefreshKernel<true, 3, rgb24>, fillRefreshKernel<true, 4, rgb24> }
+};
+
+template <typename RGB, unsigned int optionFlags> template <bool colorCorrection, int brightnessShifts>
+inline rgb48 SMLayerBackground<RGB, optionFlags>::getRefreshPixel(const RGB &pixel, const color_chan_t * redLUT, const color_chan_t * greenLUT, const color_chan_t * blueLUT) {
+    if(colorCorrection) {
+        if(sizeof(RGB) <= 3) {
+            // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
+            return rgb48(redLUT[pixel.red << brightnessShifts], greenLUT[pixel.green << brightnessShifts], blueLUT[pixel.blue << brightnessShifts]);
+        } else {
+            // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
+            return rgb48(redLUT[pixel.red >> (4 - brightnessShifts)], greenLUT[pixel.green >> (4 - brightnessShifts)], blueLUT[pixel.blue >> (4 - brightnessShifts)]);
         }
     } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            currentPixel = *ptr++;
-            // load background pixel without color correction
-            if(sizeof(RGB) <= 3) {
-                refreshRow[i] = rgb24(currentPixel.red << brightnessShifts,
-                    currentPixel.green << brightnessShifts,
-                    currentPixel.blue << brightnessShifts);
-            } else {
-                refreshRow[i] = rgb48(currentPixel.red << brightnessShifts,
-                    currentPixel.green << brightnessShifts,
-                    currentPixel.blue << brightnessShifts);
-            }
-        }
+        // shift 24-bit source up to fit in 16-bit color channel, rgb24 refresh pixels take the MSBs back
+        const int shifts = brightnessShifts + ((sizeof(RGB) <= 3) ? 8 : 0);
+        return rgb48(pixel.red << shifts, pixel.green << shifts, pixel.blue << shifts);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags> template <bool colorCorrection, int brightnessShifts, typename RGB_OUT>
+void SMLayerBackground<RGB, optionFlags>::fillRefreshKernel(const RGB * src, uint16_t numPixels, RGB_OUT refreshPixels[], const color_chan_t * const luts[3]) {
+    // without color correction, a source with the same channel size as the refresh pixels only needs each channel shifted
+    if(!colorCorrection && sizeof(RGB) == sizeof(RGB_OUT)) {
+        if(sizeof(RGB) <= 3)
+            shiftRefreshLanes<brightnessShifts, uint8_t>(src, numPixels, refreshPixels);
+        else
+            shiftRefreshLanes<brightnessShifts, uint16_t>(src, numPixels, refreshPixels);
+        return;
+    }
+
+    // the LUTs can alias refreshPixels as far as the compiler knows, load them once
+    const color_chan_t * redLUT = luts[0];
+    const color_chan_t * greenLUT = luts[1];
+    const color_chan_t * blueLUT = luts[2];
+    int i = 0;
+
+    for(; i + 4 <= numPixels; i += 4) {
+        refreshPixels[i] = getRefreshPixel<colorCorrection, brightnessShifts>(src[i], redLUT, greenLUT, blueLUT);
+        refreshPixels[i+1] = getRefreshPixel<colorCorrection, brightnessShifts>(src[i+1], redLUT, greenLUT, blueLUT);
+        refreshPixels[i+2] = getRefreshPixel<colorCorrection, brightnessShifts>(src[i+2], redLUT, greenLUT, blueLUT);
+        refreshPixels[i+3] = getRefreshPixel<colorCorrection, brightnessShifts>(src[i+3], redLUT, greenLUT, blueLUT);
+    }
+
+    for(; i < numPixels; i++)
+        refreshPixels[i] = getRefreshPixel<colorCorrection, brightnessShifts>(src[i], redLUT, greenLUT, blueLUT);
+}
+
+// every byte (24-bit color) or halfword (48-bit color) of the row is a channel, shift a word of channels at a time
+template <typename RGB, unsigned int optionFlags> template <int brightnessShifts, typename LANE>
+void SMLayerBackground<RGB, optionFlags>::shiftRefreshLanes(const RGB * src, uint16_t numPixels, void * refreshPixels) {
+    const uint8_t * in = (const uint8_t *)src;
+    uint8_t * out = (uint8_t *)refreshPixels;
+    int numBytes = numPixels * sizeof(RGB);
+
+    if(!brightnessShifts) {
+        memcpy(out, in, numBytes);
+        return;
+    }
+
+    // clear the bits shifted into each channel from the channel below it
+    const uint32_t laneMask = (LANE)((LANE)~0 << brightnessShifts);
+    const uint32_t wordMask = laneMask * ((sizeof(LANE) == 1) ? 0x01010101 : 0x00010001);
+
+    // memcpy lets the compiler use word loads and stores where the target allows unaligned access
+    int i = 0;
+    for(; i + 4 <= numBytes; i += 4) {
+        uint32_t word;
+        memcpy(&word, &in[i], sizeof(word));
+        word = (word << brightnessShifts) & wordMask;
+        memcpy(&out[i], &word, sizeof(word));
+    }
+
+    for(; i < numBytes; i += sizeof(LANE)) {
+        LANE lane;
+        memcpy(&lane, &in[i], sizeof(lane));
+        lane <<= brightnessShifts;
+        memcpy(&out[i], &lane, sizeof(lane));
     }
 }
 
@@ -193,9 +273,86 @@ extern volatile int framesInterpolated;
 
 #define INLINE __attribute__( ( always_inline ) ) inline
 
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackground<RGB, optionFlags>::markDrawPixelsChanged(uint16_t hwx0, uint16_t hwx1, uint16_t hwy) {
+    this->markDrawRowChanged(hwy);
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    if(hwx0 < drawPixelsChangedFirstX[hwy])
+        drawPixelsChangedFirstX[hwy] = hwx0;
+    if(hwx1 >= drawPixelsChangedEndX[hwy])
+        drawPixelsChangedEndX[hwy] = hwx1 + 1;
+}
+
+// marks column hwx changed in rows hwy0 through hwy1
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::markDrawColumnChanged(uint16_t hwx, uint16_t hwy0, uint16_t hwy1) {
+    this->markDrawRowsChanged(hwy0, hwy1);
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    for(int i = hwy0; i <= hwy1; i++) {
+        if(hwx < drawPixelsChangedFirstX[i])
+            drawPixelsChangedFirstX[i] = hwx;
+        if(hwx >= drawPixelsChangedEndX[i])
+            drawPixelsChangedEndX[i] = hwx + 1;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::markAllDrawPixelsChanged(void) {
+    this->markAllDrawRowsChanged();
+    allDrawPixelsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::clearDrawPixelsChanged(void) {
+    this->clearDrawRowsChanged();
+    allDrawPixelsChanged = false;
+
+    if(!drawPixelsChangedFirstX)
+        return;
+
+    for(int i=0; i<this->matrixHeight; i++) {
+        drawPixelsChangedFirstX[i] = this->matrixWidth;
+        drawPixelsChangedEndX[i] = 0;
+    }
+}
+
+// copies only the pixels drawn since the buffers last matched, or the whole buffer if enough changed that row by row copies aren't worth it
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::copyChangedDrawPixels(RGB * drawBuffer, const RGB * refreshBuffer) {
+    uint32_t bufferPixels = this->matrixWidth * this->matrixHeight;
+    uint32_t changedPixels = bufferPixels;
+
+    if(!allDrawPixelsChanged && drawPixelsChangedFirstX) {
+        changedPixels = 0;
+        for(int i=0; i<this->matrixHeight; i++) {
+            if(drawPixelsChangedEndX[i] > drawPixelsChangedFirstX[i])
+                changedPixels += drawPixelsChangedEndX[i] - drawPixelsChangedFirstX[i];
+        }
+    }
+
+    if(changedPixels > bufferPixels / SM_BACKGROUND_PARTIAL_COPY_MAX_FRACTION) {
+        memcpy((void *)drawBuffer, (void *)refreshBuffer, sizeof(RGB) * bufferPixels);
+        return;
+    }
+
+    for(int i=0; i<this->matrixHeight; i++) {
+        if(drawPixelsChangedEndX[i] > drawPixelsChangedFirstX[i]) {
+            int offset = (i * this->matrixWidth) + drawPixelsChangedFirstX[i];
+            memcpy((void *)&drawBuffer[offset], (void *)&refreshBuffer[offset], sizeof(RGB) * (drawPixelsChangedEndX[i] - drawPixelsChangedFirstX[i]));
+        }
+    }
+}
+
 template <typename RGB, unsigned int optionFlags>
 INLINE void SMLayerBackground<RGB, optionFlags>::loadPixelToDrawBuffer(int16_t hwx, int16_t hwy, const RGB& color) {
     currentDrawBufferPtr[(hwy * this->matrixWidth) + hwx] = color;
+    markDrawPixelsChanged(hwx, hwx, hwy);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -233,21 +390,21 @@ void SMLayerBackground<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const
 // x0, x1, and y must be in bounds (0-this->localWidth/Height-1), x1 > x0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color) {
-    int i;
-
-    for (i = x0; i <= x1; i++) {
-        loadPixelToDrawBuffer(i, y, color);
-    }
+    fillColorSpan(&currentDrawBufferPtr[(y * this->matrixWidth) + x0], x1 - x0 + 1, color);
+    markDrawPixelsChanged(x0, x1, y);
 }
 
 // x, y0, and y1 must be in bounds (0-this->localWidth/Height-1), y1 > y0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color) {
     int i;
+    RGB * pixel = &currentDrawBufferPtr[(y0 * this->matrixWidth) + x];
 
     for (i = y0; i <= y1; i++) {
-        loadPixelToDrawBuffer(x, i, color);
+        *pixel = color;
+        pixel += this->matrixWidth;
     }
+    markDrawColumnChanged(x, y0, y1);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -843,17 +1000,55 @@ void SMLayerBackground<RGB, optionFlags>::drawRectangle(int16_t x0, int16_t y0,
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
     int i;
+    int16_t hwx0, hwy0, hwx1, hwy1;
+
 // Loop only works if y1 > y0
     if (y0 > y1) {
         SWAPint(y0, y1);
     };
-// Putting the x coordinates in order saves multiple swaps in drawFastHLine
     if (x0 > x1) {
         SWAPint(x0, x1);
     };
 
-    for (i = y0; i <= y1; i++) {
-        drawFastHLine(x0, x1, i, color);
+    // check for completely out of bounds rectangle
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    // the rectangle is still a rectangle in hardware coordinates, map it once and fill it a hardware row at a time
+    if (this->layerRotation == rotation0) {
+        hwx0 = x0;
+        hwx1 = x1;
+        hwy0 = y0;
+        hwy1 = y1;
+    } else if (this->layerRotation == rotation180) {
+        hwx0 = (this->matrixWidth - 1) - x1;
+        hwx1 = (this->matrixWidth - 1) - x0;
+        hwy0 = (this->matrixHeight - 1) - y1;
+        hwy1 = (this->matrixHeight - 1) - y0;
+    } else if (this->layerRotation == rotation90) {
+        hwx0 = (this->matrixWidth - 1) - y1;
+        hwx1 = (this->matrixWidth - 1) - y0;
+        hwy0 = x0;
+        hwy1 = x1;
+    } else { /* if (layerRotation == rotation270)*/
+        hwx0 = y0;
+        hwx1 = y1;
+        hwy0 = (this->matrixHeight - 1) - x1;
+        hwy1 = (this->matrixHeight - 1) - x0;
+    }
+
+    for (i = hwy0; i <= hwy1; i++) {
+        drawHardwareHLine(hwx0, hwx1, i, color);
     }
 }
 
@@ -862,6 +1057,119 @@ void SMLayerBackground<RGB, optionFlags>::fillScreen(const RGB& color) {
     fillRectangle(0, 0, this->localWidth - 1, this->localHeight - 1, color);
 }
 
+// copies a width x height block of pixels to x,y, clipping the block to the layer once
+// bitmapStride is the number of pixels from the start of one bitmap row to the next, 0 if the rows are packed
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_IN>
+void SMLayerBackground<RGB, optionFlags>::blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap, uint16_t bitmapStride) {
+    int i, j, tileX, tileY;
+    int x0 = x, y0 = y, x1 = x + width - 1, y1 = y + height - 1;
+    int hwx0, hwy0, hwx1, hwy1;
+    int rowStep, pixelStep;
+    RGB * pixel;
+    RGB * firstPixel;
+
+    if (!bitmapStride)
+        bitmapStride = width;
+
+    // check for empty or completely out of bounds block
+    if (width <= 0 || height <= 0 || x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds, moving the start of the bitmap to match
+    if (x0 < 0) {
+        bitmap += -x0;
+        x0 = 0;
+    }
+    if (y0 < 0) {
+        bitmap += -y0 * bitmapStride;
+        y0 = 0;
+    }
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    width = x1 - x0 + 1;
+    height = y1 - y0 + 1;
+
+    if (this->layerRotation == rotation0) {
+        hwx0 = x0;
+        hwx1 = x1;
+        hwy0 = y0;
+        hwy1 = y1;
+
+        for (j = 0; j < height; j++)
+            copyColorSpan(&currentDrawBufferPtr[((hwy0 + j) * this->matrixWidth) + hwx0], &bitmap[j * bitmapStride], width);
+    } else if (this->layerRotation == rotation180) {
+        hwx0 = (this->matrixWidth - 1) - x1;
+        hwx1 = (this->matrixWidth - 1) - x0;
+        hwy0 = (this->matrixHeight - 1) - y1;
+        hwy1 = (this->matrixHeight - 1) - y0;
+
+        // each bitmap row is a hardware row in reverse order
+        for (j = 0; j < height; j++) {
+            pixel = &currentDrawBufferPtr[((hwy1 - j) * this->matrixWidth) + hwx1];
+            for (i = 0; i < width; i++)
+                *pixel-- = bitmap[(j * bitmapStride) + i];
+        }
+    } else {
+        // each bitmap column is a hardware row, transpose a tile at a time so neither the bitmap or the buffer is walked a full column at a time
+        if (this->layerRotation == rotation90) {
+            hwx0 = (this->matrixWidth - 1) - y1;
+            hwx1 = (this->matrixWidth - 1) - y0;
+            hwy0 = x0;
+            hwy1 = x1;
+
+            firstPixel = &currentDrawBufferPtr[(hwy0 * this->matrixWidth) + hwx1];
+            rowStep = this->matrixWidth;
+            pixelStep = -1;
+        } else { /* if (layerRotation == rotation270)*/
+            hwx0 = y0;
+            hwx1 = y1;
+            hwy0 = (this->matrixHeight - 1) - x1;
+            hwy1 = (this->matrixHeight - 1) - x0;
+
+            firstPixel = &currentDrawBufferPtr[(hwy1 * this->matrixWidth) + hwx0];
+            rowStep = -this->matrixWidth;
+            pixelStep = 1;
+        }
+
+        for (tileY = 0; tileY < height; tileY += SM_BACKGROUND_BLIT_TILE_SIZE) {
+            for (tileX = 0; tileX < width; tileX += SM_BACKGROUND_BLIT_TILE_SIZE) {
+                for (i = tileX; i < min(tileX + SM_BACKGROUND_BLIT_TILE_SIZE, width); i++) {
+                    pixel = firstPixel + (i * rowStep) + (tileY * pixelStep);
+
+                    for (j = tileY; j < min(tileY + SM_BACKGROUND_BLIT_TILE_SIZE, height); j++) {
+                        *pixel = bitmap[(j * bitmapStride) + i];
+                        pixel += pixelStep;
+                    }
+                }
+            }
+        }
+    }
+
+    for (j = hwy0; j <= hwy1; j++)
+        markDrawPixelsChanged(hwx0, hwx1, j);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::blitRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap, uint16_t bitmapStride) {
+    // rgb16 has the same layout as a RGB565 uint16_t
+    blitRect(x, y, width, height, (const rgb16 *)bitmap, bitmapStride);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_IN>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const RGB_IN * bitmap) {
+    blitRect(x, y, width, height, bitmap, 0);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t * bitmap) {
+    blitRect(x, y, width, height, bitmap, 0);
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& outlineColor, const RGB& fillColor) {
     fillRectangle(x0, y0, x1, y1, fillColor);
@@ -944,8 +1252,12 @@ bool SMLayerBackground<RGB, optionFlags>::isSwapPending(void) {
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::handleBufferSwap(void) {
-    if (!swapPending)
+    if (!swapPending) {
+        this->updateRefreshRowsChanged(false);
         return;
+    }
+
+    this->updateRefreshRowsChanged(true);
 
     unsigned char newDrawBuffer = currentRefreshBuffer;
 
@@ -970,10 +1282,14 @@ void SMLayerBackground<RGB, optionFlags>::swapBuffers(bool copy) {
         while (swapPending);
 #if 1
         // workaround for bizarre (optimization) bug - currentDrawBuffer and currentRefreshBuffer are volatile and are changed by an ISR while we're waiting for swapPending here.  They can't be used as parameters to memcpy directly though.  
+        // only the pixels drawn since the last copy differ between the buffers
         if(currentDrawBuffer)
-            memcpy((void *)backgroundBuffers[1], (void *)backgroundBuffers[0], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+            copyChangedDrawPixels(backgroundBuffers[1], backgroundBuffers[0]);
         else
-            memcpy((void *)backgroundBuffers[0], (void *)backgroundBuffers[1], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+            copyChangedDrawPixels(backgroundBuffers[0], backgroundBuffers[1]);
+
+        // drawing buffer now matches the refresh buffer
+        clearDrawPixelsChanged();
 #else
         // Similar code also drawing from volatile variables doesn't work if optimization is turned on: currentDrawBuffer will be equal to currentRefreshBuffer and cause a crash from memcpy copying a buffer to itself.  Why?
         memcpy((void *)backgroundBuffers[currentDrawBuffer], (void *)backgroundBuffers[currentRefreshBuffer], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
@@ -990,27 +1306,37 @@ void SMLayerBackground<RGB, optionFlags>::swapBuffers(bool copy) {
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::copyRefreshToDrawing() {
-    memcpy((void *)currentDrawBufferPtr, (void *)currentRefreshBufferPtr, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+    copyChangedDrawPixels(currentDrawBufferPtr, currentRefreshBufferPtr);
+    clearDrawPixelsChanged();
 }
 
 // return pointer to start of currentDrawBuffer, so application can do efficient loading of bitmaps
 template <typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::backBuffer(void) {
+    // the sketch can write anywhere in the buffer
+    markAllDrawPixelsChanged();
     return currentDrawBufferPtr;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBackBuffer(RGB *newBuffer) {
   currentDrawBufferPtr = newBuffer;
+  markAllDrawPixelsChanged();
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBrightness(uint8_t brightness) {
+    if(brightness != backgroundBrightness)
+        this->markAllRefreshRowsChanged();
+
     backgroundBrightness = brightness;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    if(enabled != this->ccEnabled)
+        this->markAllRefreshRowsChanged();
+
     this->ccEnabled = enabled;
 }
 
@@ -1043,6 +1369,7 @@ const RGB SMLayerBackground<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
 
 template<typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::getRealBackBuffer() {
+  markAllDrawPixelsChanged();
   return backgroundBuffers[currentDrawBuffer];
 }
 
@@ -43,6 +43,7 @@ class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
 
         // could make this generic if moving the buffer copy code to a new function
         void swapBuffers(bool copy = true);
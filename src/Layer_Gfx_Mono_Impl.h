@@ -167,6 +167,21 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRowTemplated(
     }
 }
 
+// with transparency disabled both colors are opaque, and rows are covered over the range fillRefreshRowTemplated() sweeps
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    int16_t layerY = hardwareY - layerYOffset;
+    int16_t iRangeMin = max((int)0, (int)layerXOffset);
+    int16_t iRangeMax = min((int)this->matrixWidth, (int)(this->layerWidth + layerXOffset));
+
+    coverage.drawsPixels = !((layerY > (this->layerHeight - 1)) || (layerY < 0));
+    coverage.opaqueFirstX = iRangeMin;
+    coverage.opaqueEndX = iRangeMin;
+
+    if(coverage.drawsPixels && !transparencyEnabled && iRangeMax > iRangeMin)
+        coverage.opaqueEndX = iRangeMax;
+}
+
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
     fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
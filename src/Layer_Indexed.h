@@ -28,6 +28,12 @@
 #include "MatrixCommon.h"
 
 #define SM_INDEXED_OPTIONS_NONE     0
+// bits stored per pixel, 1 if none are set: each pixel is an index into a palette of (1 << bits) colors, index 0 is transparent
+#define SM_INDEXED_OPTIONS_2BPP     (1 << 0)
+#define SM_INDEXED_OPTIONS_4BPP     (1 << 1)
+#define SM_INDEXED_OPTIONS_8BPP     (1 << 2)
+
+#define SM_INDEXED_BITS_PER_PIXEL(options)  (((options) & SM_INDEXED_OPTIONS_8BPP) ? 8 : ((options) & SM_INDEXED_OPTIONS_4BPP) ? 4 : ((options) & SM_INDEXED_OPTIONS_2BPP) ? 2 : 1)
 
 // font
 #include "MatrixFontCommon.h"
@@ -44,6 +50,7 @@ class SMLayerIndexed : public SM_Layer {
 
         void enableColorCorrection(bool enabled);
 
+        // with 1 bit per pixel, every index other than 0 draws and sets color 1
         void setIndexedColor(uint8_t index, const RGB & newColor);
         void fillScreen(uint8_t index);
         // behavior is a little different from SMLayerBackground.swapBuffers() - will always copy, but bool forces waiting to avoid updating the drawing buffer before refresh is updated
@@ -59,15 +66,30 @@ class SMLayerIndexed : public SM_Layer {
         // todo: move somewhere else
         static bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap);
 
+        static const int paletteSize = 1 << SM_INDEXED_BITS_PER_PIXEL(optionFlags);
+
+        uint8_t getPaletteIndex(uint8_t index);
+        uint8_t getLocalPixelIndex(const uint8_t * buffer, uint16_t localScreenX, uint16_t localScreenY);
+        uint8_t getPixelIndex(uint16_t hardwareX, uint16_t hardwareY);
+        void updateCorrectedPalette(void);
+
         template <typename RGB_OUT>
-        bool getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel);
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], const RGB_OUT correctedPalette[]);
 
-        // bitmap size is 32 rows (supporting maximum dimension of screen height in all rotations), by 32 bits
+        void markDrawPixelsChanged(int16_t x0, int16_t x1, int16_t y);
+
+        // bitmap size is 32 rows (supporting maximum dimension of screen height in all rotations), by 32 pixels of SM_INDEXED_BITS_PER_PIXEL bits
         // double buffered to prevent flicker while drawing
         uint8_t * indexedBitmap;
 
 
-        RGB color;
+        RGB palette[paletteSize];
+        // palette with color correction applied (if enabled) in each refresh format, rebuilt by frameRefreshCallback() after the palette
+        // or color correction changes, so fillRefreshRow() only copies colors
+        rgb48 correctedPalette48[paletteSize];
+        rgb24 correctedPalette24[paletteSize];
+        volatile bool paletteChanged = true;
+
         unsigned char currentframe = 0;
         char text[textLayerMaxStringLength];
 
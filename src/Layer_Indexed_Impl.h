@@ -23,7 +23,9 @@
 
 #include <string.h>
 
-#define INDEXED_BUFFER_ROW_SIZE     (this->localWidth / 8)
+#define INDEXED_BITS_PER_PIXEL      SM_INDEXED_BITS_PER_PIXEL(optionFlags)
+#define INDEXED_PIXELS_PER_BYTE     (8 / INDEXED_BITS_PER_PIXEL)
+#define INDEXED_BUFFER_ROW_SIZE     (this->localWidth / INDEXED_PIXELS_PER_BYTE)
 #define INDEXED_BUFFER_SIZE         (INDEXED_BUFFER_ROW_SIZE * this->localHeight)
 
 template <typename RGB, unsigned int optionFlags>
@@ -32,22 +34,24 @@ SMLayerIndexed<RGB, optionFlags>::SMLayerIndexed(uint8_t * bitmap, uint16_t widt
     indexedBitmap = bitmap;
     this->matrixWidth = width;
     this->matrixHeight = height;
-    this->color = rgb48(0xffff, 0xffff, 0xffff);
+    for(int i=0; i<paletteSize; i++)
+        this->palette[i] = rgb48(0xffff, 0xffff, 0xffff);
 }
 
 template <typename RGB, unsigned int optionFlags>
 SMLayerIndexed<RGB, optionFlags>::SMLayerIndexed(uint16_t width, uint16_t height) {
     // size of bitmap is 2 * INDEXED_BUFFER_SIZE
-    indexedBitmap = (uint8_t*)malloc(2 * width * (height / 8));
+    indexedBitmap = (uint8_t*)malloc(2 * width * (height / 8) * INDEXED_BITS_PER_PIXEL);
 #ifdef ESP32
     assert(indexedBitmap != NULL);
 #else
     //this->assert(indexedBitmap != NULL);
 #endif
-    memset(indexedBitmap, 0x00, 2 * width * (height / 8));
+    memset(indexedBitmap, 0x00, 2 * width * (height / 8) * INDEXED_BITS_PER_PIXEL);
     this->matrixWidth = width;
     this->matrixHeight = height;
-    this->color = rgb48(0xffff, 0xffff, 0xffff);
+    for(int i=0; i<paletteSize; i++)
+        this->palette[i] = rgb48(0xffff, 0xffff, 0xffff);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -55,16 +59,58 @@ void SMLayerIndexed<RGB, optionFlags>::begin(void) {
     currentDrawBuffer = 0;
     currentRefreshBuffer = 1;
     swapPending = false;
+
+    this->beginChangedRowTracking();
+    updateCorrectedPalette();
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::frameRefreshCallback(void) {
+    // the corrected palette is a cache of the color correction curves too
+    if(this->updateColorCorrectionVersion())
+        paletteChanged = true;
+
     handleBufferSwap();
+
+    if(paletteChanged)
+        updateCorrectedPalette();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::updateCorrectedPalette(void) {
+    paletteChanged = false;
+
+    for(int i=0; i<paletteSize; i++) {
+        if(this->ccEnabled) {
+            colorCorrection(palette[i], correctedPalette48[i]);
+            colorCorrection(palette[i], correctedPalette24[i]);
+        } else {
+            correctedPalette48[i] = palette[i];
+            correctedPalette24[i] = palette[i];
+        }
+    }
 }
 
-// returns true and copies color to xyPixel if pixel is opaque, returns false if not
-template<typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
-bool SMLayerIndexed<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel) {
+// the value stored in the bitmap for index
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerIndexed<RGB, optionFlags>::getPaletteIndex(uint8_t index) {
+    if(INDEXED_BITS_PER_PIXEL == 1)
+        return index ? 1 : 0;
+
+    return index & (paletteSize - 1);
+}
+
+// pixels are packed MSB first, the leftmost pixel of each byte is in the top bits
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerIndexed<RGB, optionFlags>::getLocalPixelIndex(const uint8_t * buffer, uint16_t localScreenX, uint16_t localScreenY) {
+    uint8_t pixelBits = buffer[(localScreenY * INDEXED_BUFFER_ROW_SIZE) + (localScreenX / INDEXED_PIXELS_PER_BYTE)];
+
+    return (pixelBits >> ((8 - INDEXED_BITS_PER_PIXEL) - ((localScreenX % INDEXED_PIXELS_PER_BYTE) * INDEXED_BITS_PER_PIXEL))) & (paletteSize - 1);
+}
+
+// returns the palette index of the pixel in the refresh buffer, 0 if transparent
+template<typename RGB, unsigned int optionFlags>
+uint8_t SMLayerIndexed<RGB, optionFlags>::getPixelIndex(uint16_t hardwareX, uint16_t hardwareY) {
     uint16_t localScreenX, localScreenY;
 
     // convert hardware x/y to the pixel in the local screen
@@ -87,84 +133,123 @@ bool SMLayerIndexed<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t har
         break;
       default:
         // TODO: Should throw an error
-        return false;
+        return 0;
     };
 
-    uint8_t bitmask = 0x80 >> (localScreenX % 8);
-
-    if (indexedBitmap[(currentRefreshBuffer * INDEXED_BUFFER_SIZE) + (localScreenY * INDEXED_BUFFER_ROW_SIZE) + (localScreenX/8)] & bitmask) {
-        xyPixel = color;
-        return true;
-    }
-
-    return false;
+    return getLocalPixelIndex(&indexedBitmap[currentRefreshBuffer * INDEXED_BUFFER_SIZE], localScreenX, localScreenY);
 }
 
+// marks the hardware rows containing local pixels x0-x1 of row y as changed in the drawing buffer
 template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
+void SMLayerIndexed<RGB, optionFlags>::markDrawPixelsChanged(int16_t x0, int16_t x1, int16_t y) {
     int i;
 
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
-
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+    if(x0 < 0) x0 = 0;
+    if(x1 >= this->localWidth) x1 = this->localWidth - 1;
 
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
-        }
-    }
+    switch( this->layerRotation ) {
+      case rotation0 :
+        this->markDrawRowChanged(y);
+        break;
+      case rotation180 :
+        this->markDrawRowChanged((this->matrixHeight - 1) - y);
+        break;
+      case  rotation90 :
+        for(i=x0; i<=x1; i++)
+            this->markDrawRowChanged(i);
+        break;
+      case  rotation270 :
+        for(i=x0; i<=x1; i++)
+            this->markDrawRowChanged((this->matrixHeight - 1) - i);
+        break;
+      default:
+        this->markAllDrawRowsChanged();
+        break;
+    };
 }
 
-template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerIndexed<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], const RGB_OUT correctedPalette[]) {
     int i;
 
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+    if(this->layerRotation == rotation0 || this->layerRotation == rotation180) {
+        // hardware rows are local rows, walk the row a byte at a time so fully transparent bytes are skipped
+        bool mirrored = (this->layerRotation == rotation180);
+        uint16_t localScreenY = mirrored ? (this->matrixHeight - 1) - hardwareY : hardwareY;
+        const uint8_t * rowBits = &indexedBitmap[(currentRefreshBuffer * INDEXED_BUFFER_SIZE) + (localScreenY * INDEXED_BUFFER_ROW_SIZE)];
 
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
+        // addressed like getLocalPixelIndex(), which runs into the next row's bytes if the width isn't a multiple of the pixels per byte
+        for(i=0; i<(this->matrixWidth + INDEXED_PIXELS_PER_BYTE - 1) / INDEXED_PIXELS_PER_BYTE; i++) {
+            uint8_t pixelBits = rowBits[i];
+
+            if(!pixelBits)
                 continue;
 
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
+            for(int j=0; j<INDEXED_PIXELS_PER_BYTE; j++) {
+                uint8_t index = (pixelBits >> (8 - INDEXED_BITS_PER_PIXEL)) & (paletteSize - 1);
+                pixelBits <<= INDEXED_BITS_PER_PIXEL;
+
+                if(!index)
+                    continue;
+
+                uint16_t localScreenX = (i * INDEXED_PIXELS_PER_BYTE) + j;
+                if(localScreenX >= this->matrixWidth)
+                    break;
+
+                refreshRow[mirrored ? (this->matrixWidth - 1) - localScreenX : localScreenX] = correctedPalette[index];
+            }
         }
+        return;
     }
+
+    for(i=0; i<this->matrixWidth; i++) {
+        uint8_t index = getPixelIndex(i, hardwareY);
+
+        if(index)
+            refreshRow[i] = correctedPalette[index];
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, correctedPalette48);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, correctedPalette24);
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::setIndexedColor(uint8_t index, const RGB & newColor) {
-    color = newColor;
+    RGB &color = palette[getPaletteIndex(index)];
+
+    // rows using the color aren't tracked
+    if(newColor.red != color.red || newColor.green != color.green || newColor.blue != color.blue) {
+        this->markAllRefreshRowsChanged();
+        color = newColor;
+        paletteChanged = true;
+    }
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::enableColorCorrection(bool enabled) {
-    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    bool newCcEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    if(newCcEnabled != this->ccEnabled) {
+        this->markAllRefreshRowsChanged();
+        paletteChanged = true;
+    }
+
+    this->ccEnabled = newCcEnabled;
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::fillScreen(uint8_t index) {
-    uint8_t fillValue;
-    if(index)
-        fillValue = 0xFF;
-    else
-        fillValue = 0x00;
+    // repeat the index for every pixel in the byte
+    uint8_t fillValue = getPaletteIndex(index) * (0xFF / (paletteSize - 1));
 
     memset(&indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE], fillValue, INDEXED_BUFFER_SIZE);
+    this->markAllDrawRowsChanged();
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -182,6 +267,9 @@ void SMLayerIndexed<RGB, optionFlags>::swapBuffers(bool copy) {
             memcpy(&indexedBitmap[INDEXED_BUFFER_SIZE], &indexedBitmap[0], INDEXED_BUFFER_SIZE);
         else
             memcpy(&indexedBitmap[0], &indexedBitmap[INDEXED_BUFFER_SIZE], INDEXED_BUFFER_SIZE);
+
+        // drawing buffer now matches the refresh buffer
+        this->clearDrawRowsChanged();
 #else
         // below is untested after copying from backgroundLayer to indexedLayer:
 
@@ -200,8 +288,12 @@ void SMLayerIndexed<RGB, optionFlags>::swapBuffers(bool copy) {
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::handleBufferSwap(void) {
-    if (!swapPending)
+    if (!swapPending) {
+        this->updateRefreshRowsChanged(false);
         return;
+    }
+
+    this->updateRefreshRowsChanged(true);
 
     unsigned char newDrawBuffer = currentRefreshBuffer;
 
@@ -218,13 +310,13 @@ void SMLayerIndexed<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint8_t i
     if(x < 0 || x >= this->localWidth || y < 0 || y >= this->localHeight)
         return;
 
-    if(index) {
-        tempBitmask = 0x80 >> (x%8);
-        indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x/8)] |= tempBitmask;
-    } else {
-        tempBitmask = ~(0x80 >> (x%8));
-        indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x/8)] &= tempBitmask;
-    }
+    markDrawPixelsChanged(x, x, y);
+
+    int shift = (8 - INDEXED_BITS_PER_PIXEL) - ((x % INDEXED_PIXELS_PER_BYTE) * INDEXED_BITS_PER_PIXEL);
+    uint8_t &pixelBits = indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x / INDEXED_PIXELS_PER_BYTE)];
+
+    tempBitmask = (paletteSize - 1) << shift;
+    pixelBits = (pixelBits & ~tempBitmask) | (getPaletteIndex(index) << shift);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -249,6 +341,17 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
         if (k >= this->localHeight) return;
 
         tempBitmask = getBitmapFontRowAtXY(character, k - y, layerFont);
+
+        if (INDEXED_BITS_PER_PIXEL > 1) {
+            // draw each pixel of the glyph row with the index
+            for (int j = 0; j < 8; j++) {
+                if (tempBitmask & (0x80 >> j))
+                    drawPixel(x + j, k, index);
+            }
+            continue;
+        }
+
+        markDrawPixelsChanged(x, x + 7, k);
         if (x < 0) {
             indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (k * INDEXED_BUFFER_ROW_SIZE) + 0] |= tempBitmask << -x;
         } else {
@@ -30,6 +30,11 @@
 // scroll text
 const int textLayerMaxStringLength = 100;
 
+// tallest font that can be pre-rendered into the text strip, text in taller fonts is drawn into the bitmap one glyph at a time
+#ifndef SCROLLING_TEXT_STRIP_MAX_FONT_HEIGHT
+#define SCROLLING_TEXT_STRIP_MAX_FONT_HEIGHT    16
+#endif
+
 #define SM_SCROLLING_OPTIONS_NONE     0
 
 // font
@@ -46,6 +51,8 @@ class SMLayerScrolling : public SM_Layer {
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
 
         void setRefreshRate(uint8_t newRefreshRate);
+        void setRotation(rotationDegrees newrotation);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
 
         // size of bitmap is 1 bit per pixel for width*height (no need for double buffering)
         uint8_t * scrollingBitmap;
@@ -67,6 +74,18 @@ class SMLayerScrolling : public SM_Layer {
         void setMinMax(void);
 
         void updateScrollingText(void);
+        void updateRefreshBitmap(void);
+
+        void renderTextStrip(void);
+        uint8_t getTextStripByte(int stripRow, int stripX);
+        void copyTextStripToBitmap(void);
+
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void fillRefreshRowFromTextStrip(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void fillRefreshSpans(RGB_OUT refreshRow[], int hardwareX, uint32_t bits, const RGB_OUT &color);
 
         template <typename RGB_OUT>
         bool getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel);
@@ -93,6 +112,29 @@ class SMLayerScrolling : public SM_Layer {
         unsigned int textWidth;
         int scrollMin, scrollMax;
         int scrollPosition;
+
+        // scrollingBitmap resolved to hardware rows for the current rotation, with the range of bytes in each row that have lit pixels,
+        // rebuilt when the text is redrawn instead of converting every pixel of every row in fillRefreshRow()
+        struct refreshRowRange {
+            uint16_t firstByte;
+            uint16_t endByte;
+        };
+        uint8_t * refreshBitmap = NULL;
+        refreshRowRange * refreshRowRanges = NULL;
+        bool refreshBitmapChanged = true;
+
+        // the whole string rendered once at 1 bit per pixel, font rows by textStripRowSize bytes, rendered again only when the text
+        // or font changes.  Scrolling moves the position the strip is read from, textStripPosition/textStripTopOffset are the
+        // scrollPosition/fontTopOffset the current frame is drawn at
+        uint8_t * textStrip = NULL;
+        uint16_t textStripRowSize;
+        uint8_t textStripHeight;
+        int textStripPosition;
+        int textStripTopOffset;
+        bool textStripChanged = true;
+        bool textStripValid = false;
+        // set when rows are filled straight from textStrip, and scrollingBitmap/refreshBitmap aren't kept up to date
+        bool readTextStripRows = false;
 };
 
 #include "Layer_Scrolling_Impl.h"
@@ -25,6 +25,9 @@
 
 #define SCROLLING_BUFFER_ROW_SIZE   (this->localWidth / 8)
 #define SCROLLING_BUFFER_SIZE       (SCROLLING_BUFFER_ROW_SIZE * this->localHeight)
+#define SCROLLING_REFRESH_ROW_SIZE  (ROUND_UP_TO_MULTIPLE_OF_8(this->matrixWidth) / 8)
+// glyphs are at most 8 pixels wide, one byte per character plus a byte for the last glyph spilling past its width
+#define SCROLLING_TEXT_STRIP_SIZE   ((textLayerMaxStringLength + 1) * SCROLLING_TEXT_STRIP_MAX_FONT_HEIGHT)
 
 template <typename RGB, unsigned int optionFlags>
 SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint8_t * bitmap, uint16_t width, uint16_t height) {
@@ -50,11 +53,207 @@ SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint16_t width, uint16_t he
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::begin(void) {
+    if(!refreshBitmap) {
+        refreshBitmap = (uint8_t *)malloc(SCROLLING_REFRESH_ROW_SIZE * this->matrixHeight);
+        refreshRowRanges = (refreshRowRange *)malloc(sizeof(refreshRowRange) * this->matrixHeight);
+    }
+
+    // without both buffers, fillRefreshRow() falls back to reading scrollingBitmap for every pixel
+    if(!refreshBitmap || !refreshRowRanges) {
+        free(refreshBitmap);
+        free(refreshRowRanges);
+        refreshBitmap = NULL;
+        refreshRowRanges = NULL;
+    } else {
+        memset(refreshRowRanges, 0x00, sizeof(refreshRowRange) * this->matrixHeight);
+    }
+
+    // without the strip, the text is drawn into scrollingBitmap one glyph at a time for every scroll step
+    if(!textStrip)
+        textStrip = (uint8_t *)malloc(SCROLLING_TEXT_STRIP_SIZE);
+
+    refreshBitmapChanged = true;
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::frameRefreshCallback(void) {
     updateScrollingText();
+
+    if(refreshBitmapChanged) {
+        // strip rows are hardware rows unless the layer is rotated by 90 or 270 degrees
+        readTextStripRows = textStripValid && (this->layerRotation == rotation0 || this->layerRotation == rotation180);
+
+        if(!readTextStripRows) {
+            if(textStripValid)
+                copyTextStripToBitmap();
+            updateRefreshBitmap();
+        }
+        refreshBitmapChanged = false;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+    refreshBitmapChanged = true;
+}
+
+// copy each lit pixel of scrollingBitmap to its hardware position, and find the bytes of each hardware row that need to be drawn
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::updateRefreshBitmap(void) {
+    if(!refreshBitmap)
+        return;
+
+    memset(refreshBitmap, 0x00, SCROLLING_REFRESH_ROW_SIZE * this->matrixHeight);
+
+    for(uint16_t localScreenY = 0; localScreenY < this->localHeight; localScreenY++) {
+        for(uint16_t localScreenX = 0; localScreenX < this->localWidth; localScreenX++) {
+            // address the bitmap the same way as getPixel()
+            uint8_t bits = scrollingBitmap[(localScreenY * SCROLLING_BUFFER_ROW_SIZE) + (localScreenX/8)];
+
+            if(!bits) {
+                // skip to the next byte
+                localScreenX |= 7;
+                continue;
+            }
+
+            if(!(bits & (0x80 >> (localScreenX % 8))))
+                continue;
+
+            uint16_t hardwareX, hardwareY;
+
+            // inverse of the conversion in getPixel()
+            switch( this->layerRotation ) {
+              case rotation0 :
+                hardwareX = localScreenX;
+                hardwareY = localScreenY;
+                break;
+              case rotation180 :
+                hardwareX = (this->matrixWidth - 1) - localScreenX;
+                hardwareY = (this->matrixHeight - 1) - localScreenY;
+                break;
+              case  rotation90 :
+                hardwareX = (this->matrixWidth - 1) - localScreenY;
+                hardwareY = localScreenX;
+                break;
+              case  rotation270 :
+                hardwareX = localScreenY;
+                hardwareY = (this->matrixHeight - 1) - localScreenX;
+                break;
+              default:
+                continue;
+            };
+
+            if(hardwareX >= this->matrixWidth || hardwareY >= this->matrixHeight)
+                continue;
+
+            refreshBitmap[(hardwareY * SCROLLING_REFRESH_ROW_SIZE) + (hardwareX / 8)] |= 0x80 >> (hardwareX % 8);
+        }
+    }
+
+    for(int hardwareY = 0; hardwareY < this->matrixHeight; hardwareY++) {
+        const uint8_t * rowBits = &refreshBitmap[hardwareY * SCROLLING_REFRESH_ROW_SIZE];
+        int firstByte = 0;
+        int endByte = SCROLLING_REFRESH_ROW_SIZE;
+
+        while(firstByte < endByte && !rowBits[firstByte])
+            firstByte++;
+        while(endByte > firstByte && !rowBits[endByte - 1])
+            endByte--;
+
+        refreshRowRanges[hardwareY].firstByte = firstByte;
+        refreshRowRanges[hardwareY].endByte = endByte;
+    }
+}
+
+// render the whole string into textStrip, called from the refresh callback after start(), update() or setFont()
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::renderTextStrip(void) {
+    int i, k;
+
+    textStripChanged = false;
+    textStripValid = false;
+
+    if(!textStrip || scrollFont->Width > 8 || scrollFont->Height > SCROLLING_TEXT_STRIP_MAX_FONT_HEIGHT)
+        return;
+
+    // the strip is read a byte at a time, which only lines up with scrollingBitmap's rows if they're a multiple of 8 pixels in any rotation
+    if(this->matrixWidth % 8 || this->matrixHeight % 8)
+        return;
+
+    textStripRowSize = (((textlen * scrollFont->Width) + 7) / 8) + 1;
+    textStripHeight = scrollFont->Height;
+
+    memset(textStrip, 0x00, textStripRowSize * textStripHeight);
+
+    for (k = 0; k < textStripHeight; k++) {
+        uint8_t * stripRow = &textStrip[k * textStripRowSize];
+
+        for (i = 0; i < textlen; i++) {
+            int charPosition = i * scrollFont->Width;
+            uint8_t tempBitmask = getBitmapFontRowAtXY(text[i], k, scrollFont);
+
+            stripRow[charPosition/8] |= tempBitmask >> (charPosition%8);
+            if(charPosition % 8)
+                stripRow[(charPosition/8) + 1] |= tempBitmask << (8-(charPosition%8));
+        }
+    }
+
+    textStripValid = true;
+}
+
+// returns 8 pixels of a strip row starting at stripX, MSB is the leftmost pixel, pixels outside the strip are off
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerScrolling<RGB, optionFlags>::getTextStripByte(int stripRow, int stripX) {
+    if(stripX <= -8 || stripX >= textStripRowSize * 8)
+        return 0;
+
+    const uint8_t * rowBits = &textStrip[stripRow * textStripRowSize];
+
+    // round down for negative stripX
+    int byteIndex = ((stripX + 8) / 8) - 1;
+    int shift = stripX - (byteIndex * 8);
+
+    uint8_t leftBits = (byteIndex >= 0) ? rowBits[byteIndex] : 0;
+    uint8_t rightBits = (byteIndex + 1 < textStripRowSize) ? rowBits[byteIndex + 1] : 0;
+
+    return (leftBits << shift) | (rightBits >> (8 - shift));
+}
+
+// draws the strip at the current position into scrollingBitmap, matching redrawScrollingText(), for rotations that need refreshBitmap
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::copyTextStripToBitmap(void) {
+    if(majorScrollFontChange) {
+        memset(scrollingBitmap, 0x00, SCROLLING_BUFFER_SIZE);
+        majorScrollFontChange = false;
+    }
+
+    for (int j = 0; j < this->localHeight; j++) {
+        int stripRow = j - textStripTopOffset;
+
+        if (stripRow < 0 || stripRow >= textStripHeight)
+            continue;
+
+        for (int i = 0; i < SCROLLING_BUFFER_ROW_SIZE; i++)
+            scrollingBitmap[(j * SCROLLING_BUFFER_ROW_SIZE) + i] = getTextStripByte(stripRow, (i * 8) - textStripPosition);
+    }
+}
+
+// text pixels don't cover anything underneath them, rows without text are reported as not drawn
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    coverage.opaqueFirstX = 0;
+    coverage.opaqueEndX = 0;
+
+    if(readTextStripRows) {
+        int localScreenY = (this->layerRotation == rotation180) ? (this->matrixHeight - 1) - hardwareY : hardwareY;
+        int stripRow = localScreenY - textStripTopOffset;
+        coverage.drawsPixels = (stripRow >= 0 && stripRow < textStripHeight);
+    } else if(refreshBitmap) {
+        coverage.drawsPixels = (refreshRowRanges[hardwareY].firstByte < refreshRowRanges[hardwareY].endByte);
+    } else {
+        coverage.drawsPixels = true;
+    }
 }
 
 // returns true and copies color to xyPixel if pixel is opaque, returns false if not
@@ -131,29 +330,89 @@ bool SMLayerScrolling<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t h
     return false;
 }
 
-template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    rgb48 currentPixel;
-    int i;
+// write each run of lit pixels in the byte as a span, MSB is the pixel at hardwareX
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerScrolling<RGB, optionFlags>::fillRefreshSpans(RGB_OUT refreshRow[], int hardwareX, uint32_t bits, const RGB_OUT &color) {
+    while(bits) {
+        int start = __builtin_clz(bits) - 24;
+        int length = __builtin_clz(~(bits << (24 + start)));
+
+        RGB_OUT * span = &refreshRow[hardwareX + start];
+        for(int j = 0; j < length; j++)
+            span[j] = color;
+
+        bits &= 0xFF >> (start + length);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerScrolling<RGB, optionFlags>::fillRefreshRowFromTextStrip(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    RGB_OUT currentPixel;
+
+    // readTextStripRows is only set for rotation0 and rotation180
+    bool mirrored = (this->layerRotation == rotation180);
+    int localScreenY = mirrored ? (this->matrixHeight - 1) - hardwareY : hardwareY;
+
+    int stripRow = localScreenY - textStripTopOffset;
+    if(stripRow < 0 || stripRow >= textStripHeight)
+        return;
+
+    // only the bytes of the row the strip covers at the current position
+    int firstX = max(textStripPosition, 0);
+    int endX = min(textStripPosition + (textStripRowSize * 8), (int)this->matrixWidth);
+    if(firstX >= endX)
+        return;
 
     if(this->ccEnabled)
         colorCorrection(textcolor, currentPixel);
     else
         currentPixel = textcolor;
 
-    for(i=0; i<this->matrixWidth; i++) {
-        if(!getPixel(i, hardwareY))
+    for(int i = firstX / 8; i < (endX + 7) / 8; i++) {
+        uint32_t bits = getTextStripByte(stripRow, (i * 8) - textStripPosition);
+
+        if(!bits)
             continue;
 
-        refreshRow[i] = currentPixel;
+        if(mirrored) {
+            bits = ((bits & 0xF0) >> 4) | ((bits & 0x0F) << 4);
+            bits = ((bits & 0xCC) >> 2) | ((bits & 0x33) << 2);
+            bits = ((bits & 0xAA) >> 1) | ((bits & 0x55) << 1);
+            fillRefreshSpans(refreshRow, this->matrixWidth - 8 - (i * 8), bits, currentPixel);
+        } else {
+            fillRefreshSpans(refreshRow, i * 8, bits, currentPixel);
+        }
     }
 }
 
-template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    rgb24 currentPixel;
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerScrolling<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    RGB_OUT currentPixel;
     int i;
 
+    if(readTextStripRows) {
+        fillRefreshRowFromTextStrip(hardwareY, refreshRow);
+        return;
+    }
+
+    if(refreshBitmap) {
+        // rows without text are skipped without looking at any pixels
+        const refreshRowRange &range = refreshRowRanges[hardwareY];
+        if(range.firstByte >= range.endByte)
+            return;
+
+        if(this->ccEnabled)
+            colorCorrection(textcolor, currentPixel);
+        else
+            currentPixel = textcolor;
+
+        const uint8_t * rowBits = &refreshBitmap[hardwareY * SCROLLING_REFRESH_ROW_SIZE];
+
+        for(i = range.firstByte; i < range.endByte; i++)
+            fillRefreshSpans(refreshRow, i * 8, rowBits[i], currentPixel);
+        return;
+    }
+
     if(this->ccEnabled)
         colorCorrection(textcolor, currentPixel);
     else
@@ -167,6 +426,16 @@ void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb2
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
 template<typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setColor(const RGB & newColor) {
     textcolor = newColor;
@@ -236,6 +505,7 @@ void SMLayerScrolling<RGB, optionFlags>::start(const char inputtext[], int numSc
     text[textLayerMaxStringLength-1] = '\0'; // add null-termination to fix compiler warning
     textlen = length;
     scrollcounter = numScrolls;
+    textStripChanged = true;
 
     textWidth = (textlen * scrollFont->Width) - 1;
 
@@ -256,12 +526,12 @@ void SMLayerScrolling<RGB, optionFlags>::update(const char inputtext[]){
     text[textLayerMaxStringLength-1] = '\0'; // add null-termination to fix compiler warning
     textlen = length;
     textWidth = (textlen * scrollFont->Width) - 1;
+    textStripChanged = true;
 
     setMinMax();
 }
 
 // called once per frame to update (virtual) bitmap
-// function needs major efficiency improvments
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
     bool resetScrolls = false;
@@ -314,7 +584,17 @@ void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
     // TODO: reset only when necessary, and update just the pixels that need it
     resetScrolls = true;
     if (resetScrolls) {
-        redrawScrollingText();
+        if (textStripChanged)
+            renderTextStrip();
+
+        // with the text already rendered, a scroll step only moves the position the strip is read from
+        if (textStripValid) {
+            textStripPosition = scrollPosition;
+            textStripTopOffset = fontTopOffset;
+        } else {
+            redrawScrollingText();
+        }
+        refreshBitmapChanged = true;
     }
 }
 
@@ -339,6 +619,7 @@ void SMLayerScrolling<RGB, optionFlags>::setSpeed(unsigned char pixels_per_secon
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setFont(fontChoices newFont) {
     scrollFont = fontLookup(newFont);
+    textStripChanged = true;
 }
 
 template <typename RGB, unsigned int optionFlags>
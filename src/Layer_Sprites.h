@@ -0,0 +1,109 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_SPRITES_H_
+#define _LAYER_SPRITES_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_SPRITES_OPTIONS_NONE     0
+
+// sprites drawn on each hardware row, like hardware sprite engines, sprites past the limit (lowest z first) are left out of the row
+#ifndef SM_SPRITES_MAX_PER_ROW
+#define SM_SPRITES_MAX_PER_ROW      16
+#endif
+
+/*  Sprites are small bitmaps drawn over the layers below without redrawing or copying a buffer: moving a sprite only updates its
+    descriptor.  Each frame, frameRefreshCallback() sorts the visible sprites by z and lists the sprites touching each hardware row,
+    then fillRefreshRow() draws only the sprites in that row's list.  The sketch keeps ownership of the bitmaps and palettes, call
+    setSprite() again after changing one in place.  Coordinates are local (rotated) coordinates like the other layers. */
+template <typename RGB, unsigned int optionFlags>
+class SMLayerSprites : public SM_Layer {
+    public:
+        SMLayerSprites(uint16_t width, uint16_t height, uint8_t maxSprites);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
+        void setRotation(rotationDegrees newrotation);
+
+        void enableColorCorrection(bool enabled);
+
+        // setSprite() also shows the sprite
+        // bitmap is width x height RGB pixels, pixels matching transparentColor aren't drawn
+        void setSprite(uint8_t id, const RGB * bitmap, uint8_t width, uint8_t height, const RGB & transparentColor);
+        // bitmap is width x height 8-bit indexes into palette, pixels with transparentIndex aren't drawn
+        void setSprite(uint8_t id, const uint8_t * bitmap, uint8_t width, uint8_t height, const RGB * palette, uint8_t transparentIndex = 0);
+        void moveSprite(uint8_t id, int16_t x, int16_t y);
+        // sprites with a higher z are drawn on top, sprites with the same z are drawn in id order
+        void setSpriteZ(uint8_t id, int8_t z);
+        void showSprite(uint8_t id, bool visible);
+
+    protected:
+        typedef struct spriteDescriptor {
+            const void * bitmap;
+            // NULL for RGB bitmaps
+            const RGB * palette;
+            RGB transparentColor;
+            int16_t x, y;
+            uint8_t width, height;
+            uint8_t transparentIndex;
+            int8_t z;
+            bool visible;
+            // hardware coordinates of the sprite's corners, only set in the refresh copy
+            int16_t hwx0, hwy0, hwx1, hwy1;
+        } spriteDescriptor;
+
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT, bool paletted>
+        void fillSpriteRow(const spriteDescriptor & sprite, uint16_t hardwareY, RGB_OUT refreshRow[]);
+
+        void updateRowLists(void);
+        void markListedRowsChanged(void);
+        void copyDrawSprites(void);
+        void beginSpriteUpdate(void);
+        void endSpriteUpdate(void);
+
+        uint8_t maxSprites;
+
+        // the sketch updates drawSprites, frameRefreshCallback() copies them to refreshSprites when spritesChanged is set
+        spriteDescriptor * drawSprites = NULL;
+        spriteDescriptor * refreshSprites = NULL;
+        volatile bool spritesChanged = true;
+        // setters increment spriteUpdates before and after writing a descriptor, it's odd while one is being written
+        volatile uint8_t spriteUpdates = 0;
+
+        // refreshSprites ids in each hardware row, sorted by z
+        uint8_t * rowSprites = NULL;
+        uint8_t * rowSpriteCounts = NULL;
+        uint8_t * sortedSprites = NULL;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+};
+
+#include "Layer_Sprites_Impl.h"
+
+#endif
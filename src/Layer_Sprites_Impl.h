@@ -0,0 +1,379 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerSprites<RGB, optionFlags>::SMLayerSprites(uint16_t width, uint16_t height, uint8_t maxSprites) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    this->maxSprites = maxSprites;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::begin(void) {
+    if(!drawSprites) {
+        drawSprites = (spriteDescriptor *)malloc(sizeof(spriteDescriptor) * maxSprites);
+        refreshSprites = (spriteDescriptor *)malloc(sizeof(spriteDescriptor) * maxSprites);
+        sortedSprites = (uint8_t *)malloc(maxSprites);
+        rowSprites = (uint8_t *)malloc(this->matrixHeight * SM_SPRITES_MAX_PER_ROW);
+        rowSpriteCounts = (uint8_t *)malloc(this->matrixHeight);
+#ifdef ESP32
+        assert(drawSprites != NULL);
+        assert(refreshSprites != NULL);
+        assert(sortedSprites != NULL);
+        assert(rowSprites != NULL);
+        assert(rowSpriteCounts != NULL);
+#else
+        //this->assert(drawSprites != NULL);
+        //this->assert(refreshSprites != NULL);
+        //this->assert(sortedSprites != NULL);
+        //this->assert(rowSprites != NULL);
+        //this->assert(rowSpriteCounts != NULL);
+#endif
+    }
+
+    // without every buffer the layer stays disabled, the setters ignore sprites and nothing is drawn
+    if(!drawSprites || !refreshSprites || !sortedSprites || !rowSprites || !rowSpriteCounts) {
+        free(drawSprites);
+        free(refreshSprites);
+        free(sortedSprites);
+        free(rowSprites);
+        free(rowSpriteCounts);
+        drawSprites = NULL;
+        refreshSprites = NULL;
+        sortedSprites = NULL;
+        rowSprites = NULL;
+        rowSpriteCounts = NULL;
+        return;
+    }
+
+    // all sprites start hidden
+    memset((void *)drawSprites, 0x00, sizeof(spriteDescriptor) * maxSprites);
+    memset((void *)refreshSprites, 0x00, sizeof(spriteDescriptor) * maxSprites);
+    memset(rowSpriteCounts, 0x00, this->matrixHeight);
+    spritesChanged = true;
+
+    this->beginChangedRowTracking();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->updateColorCorrectionVersion();
+
+    if(!rowSpriteCounts)
+        return;
+
+    if(!spritesChanged) {
+        this->updateRefreshRowsChanged(false);
+        return;
+    }
+
+    // clear the flag before copying, so an update made during the copy is picked up next frame
+    spritesChanged = false;
+
+    // rows with sprites in the previous frame or this frame changed
+    markListedRowsChanged();
+    copyDrawSprites();
+    updateRowLists();
+    markListedRowsChanged();
+
+    this->updateRefreshRowsChanged(true);
+    this->clearDrawRowsChanged();
+}
+
+// copies each sprite that isn't being written by a setter, so a descriptor never pairs a new bitmap with the previous size
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::copyDrawSprites(void) {
+    for(int i=0; i<maxSprites; i++) {
+        uint8_t updates = spriteUpdates;
+
+        if(!(updates & 1)) {
+            __sync_synchronize();
+            spriteDescriptor sprite = drawSprites[i];
+            __sync_synchronize();
+
+            if(spriteUpdates == updates) {
+                refreshSprites[i] = sprite;
+                continue;
+            }
+        }
+
+        // a setter is writing, keep the previous copy of this sprite and copy it again next frame
+        spritesChanged = true;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::markListedRowsChanged(void) {
+    for(int i=0; i<this->matrixHeight; i++) {
+        if(rowSpriteCounts[i])
+            this->markDrawRowChanged(i);
+    }
+}
+
+// sorts the visible sprites top (highest z) first, and lists them in each hardware row they touch
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::updateRowLists(void) {
+    int i, j, numSorted = 0;
+    int x0, y0, x1, y1, firstRow, lastRow;
+
+    // insertion sort, a sprite goes above sprites with a lower id and the same z
+    for(i=0; i<maxSprites; i++) {
+        const spriteDescriptor &sprite = refreshSprites[i];
+
+        if(!sprite.visible || !sprite.bitmap || !sprite.width || !sprite.height)
+            continue;
+
+        for(j=numSorted; j>0 && refreshSprites[sortedSprites[j-1]].z <= sprite.z; j--)
+            sortedSprites[j] = sortedSprites[j-1];
+
+        sortedSprites[j] = i;
+        numSorted++;
+    }
+
+    memset(rowSpriteCounts, 0x00, this->matrixHeight);
+
+    for(i=0; i<numSorted; i++) {
+        spriteDescriptor &sprite = refreshSprites[sortedSprites[i]];
+
+        x0 = sprite.x;
+        y0 = sprite.y;
+        x1 = sprite.x + sprite.width - 1;
+        y1 = sprite.y + sprite.height - 1;
+
+        // map the sprite's corners to hardware, they're used by fillSpriteRow() to find the sprite's pixels in each row
+        if (this->layerRotation == rotation0) {
+            sprite.hwx0 = x0;
+            sprite.hwx1 = x1;
+            sprite.hwy0 = y0;
+            sprite.hwy1 = y1;
+        } else if (this->layerRotation == rotation180) {
+            sprite.hwx0 = (this->matrixWidth - 1) - x1;
+            sprite.hwx1 = (this->matrixWidth - 1) - x0;
+            sprite.hwy0 = (this->matrixHeight - 1) - y1;
+            sprite.hwy1 = (this->matrixHeight - 1) - y0;
+        } else if (this->layerRotation == rotation90) {
+            sprite.hwx0 = (this->matrixWidth - 1) - y1;
+            sprite.hwx1 = (this->matrixWidth - 1) - y0;
+            sprite.hwy0 = x0;
+            sprite.hwy1 = x1;
+        } else { /* if (layerRotation == rotation270)*/
+            sprite.hwx0 = y0;
+            sprite.hwx1 = y1;
+            sprite.hwy0 = (this->matrixHeight - 1) - x1;
+            sprite.hwy1 = (this->matrixHeight - 1) - x0;
+        }
+
+        if(sprite.hwx1 < 0 || sprite.hwx0 >= this->matrixWidth)
+            continue;
+
+        firstRow = max(sprite.hwy0, 0);
+        lastRow = min(sprite.hwy1, this->matrixHeight - 1);
+
+        for(j=firstRow; j<=lastRow; j++) {
+            if(rowSpriteCounts[j] < SM_SPRITES_MAX_PER_ROW)
+                rowSprites[(j * SM_SPRITES_MAX_PER_ROW) + rowSpriteCounts[j]++] = sortedSprites[i];
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT, bool paletted>
+void SMLayerSprites<RGB, optionFlags>::fillSpriteRow(const spriteDescriptor & sprite, uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    int i, spriteX, spriteY, step;
+    int firstX = max(sprite.hwx0, 0);
+    int lastX = min(sprite.hwx1, this->matrixWidth - 1);
+
+    // find the sprite pixel at firstX, and the step through the bitmap for each hardware pixel
+    if (this->layerRotation == rotation0) {
+        spriteX = firstX - sprite.hwx0;
+        spriteY = hardwareY - sprite.hwy0;
+        step = 1;
+    } else if (this->layerRotation == rotation180) {
+        spriteX = sprite.hwx1 - firstX;
+        spriteY = sprite.hwy1 - hardwareY;
+        step = -1;
+    } else if (this->layerRotation == rotation90) {
+        spriteX = hardwareY - sprite.hwy0;
+        spriteY = sprite.hwx1 - firstX;
+        step = -sprite.width;
+    } else { /* if (layerRotation == rotation270)*/
+        spriteX = sprite.hwy1 - hardwareY;
+        spriteY = firstX - sprite.hwx0;
+        step = sprite.width;
+    }
+
+    int index = (spriteY * sprite.width) + spriteX;
+
+    for(i=firstX; i<=lastX; i++, index += step) {
+        RGB color;
+
+        if(paletted) {
+            uint8_t paletteIndex = ((const uint8_t *)sprite.bitmap)[index];
+            if(paletteIndex == sprite.transparentIndex)
+                continue;
+
+            color = sprite.palette[paletteIndex];
+        } else {
+            color = ((const RGB *)sprite.bitmap)[index];
+            if(color.red == sprite.transparentColor.red && color.green == sprite.transparentColor.green && color.blue == sprite.transparentColor.blue)
+                continue;
+        }
+
+        if(ccEnabled)
+            colorCorrection(color, refreshRow[i]);
+        else
+            refreshRow[i] = color;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SMLayerSprites<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    if(!rowSpriteCounts)
+        return;
+
+    const uint8_t * sprites = &rowSprites[hardwareY * SM_SPRITES_MAX_PER_ROW];
+
+    // the list is sorted top first, draw it bottom up
+    for(int i=rowSpriteCounts[hardwareY]-1; i>=0; i--) {
+        const spriteDescriptor &sprite = refreshSprites[sprites[i]];
+
+        if(sprite.palette)
+            fillSpriteRow<RGB_OUT, true>(sprite, hardwareY, refreshRow);
+        else
+            fillSpriteRow<RGB_OUT, false>(sprite, hardwareY, refreshRow);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    // sprites may have transparent pixels, they never cover the layers below
+    coverage.drawsPixels = rowSpriteCounts && rowSpriteCounts[hardwareY] > 0;
+    coverage.opaqueFirstX = 0;
+    coverage.opaqueEndX = 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    // the sprites map to different hardware rows
+    spritesChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    bool newCcEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    if(newCcEnabled != this->ccEnabled)
+        this->markAllRefreshRowsChanged();
+
+    this->ccEnabled = newCcEnabled;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSprite(uint8_t id, const RGB * bitmap, uint8_t width, uint8_t height, const RGB & transparentColor) {
+    if(id >= maxSprites || !drawSprites)
+        return;
+
+    beginSpriteUpdate();
+    spriteDescriptor &sprite = drawSprites[id];
+    sprite.bitmap = bitmap;
+    sprite.palette = NULL;
+    sprite.transparentColor = transparentColor;
+    sprite.width = width;
+    sprite.height = height;
+    sprite.visible = true;
+    endSpriteUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSprite(uint8_t id, const uint8_t * bitmap, uint8_t width, uint8_t height, const RGB * palette, uint8_t transparentIndex) {
+    if(id >= maxSprites || !drawSprites)
+        return;
+
+    beginSpriteUpdate();
+    spriteDescriptor &sprite = drawSprites[id];
+    sprite.bitmap = bitmap;
+    sprite.palette = palette;
+    sprite.transparentIndex = transparentIndex;
+    sprite.width = width;
+    sprite.height = height;
+    sprite.visible = true;
+    endSpriteUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::moveSprite(uint8_t id, int16_t x, int16_t y) {
+    if(id >= maxSprites || !drawSprites)
+        return;
+
+    beginSpriteUpdate();
+    drawSprites[id].x = x;
+    drawSprites[id].y = y;
+    endSpriteUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteZ(uint8_t id, int8_t z) {
+    if(id >= maxSprites || !drawSprites)
+        return;
+
+    beginSpriteUpdate();
+    drawSprites[id].z = z;
+    endSpriteUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::showSprite(uint8_t id, bool visible) {
+    if(id >= maxSprites || !drawSprites)
+        return;
+
+    beginSpriteUpdate();
+    drawSprites[id].visible = visible;
+    endSpriteUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerSprites<RGB, optionFlags>::beginSpriteUpdate(void) {
+    spriteUpdates++;
+    __sync_synchronize();
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerSprites<RGB, optionFlags>::endSpriteUpdate(void) {
+    __sync_synchronize();
+    spriteUpdates++;
+    spritesChanged = true;
+}
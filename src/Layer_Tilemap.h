@@ -0,0 +1,97 @@
+/*
+ * SmartMatrix Library - Tilemap Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_TILEMAP_H_
+#define _LAYER_TILEMAP_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_TILEMAP_OPTIONS_NONE     0
+
+// pass as transparentIndex to draw every tile pixel
+#define SM_TILEMAP_NO_TRANSPARENCY  (-1)
+
+/*  A tilemap draws a large scene from a map of 8-bit tile indexes and a shared tileset, without a frame buffer: fillRefreshRow()
+    looks up each pixel in the map and tileset directly, so scrolling only changes the offsets used for the lookup.  Tiles are 8x8 or
+    16x16 8-bit palette indexes.  The map wraps around when scrolled past its edges, and each local row can have its own extra
+    horizontal scroll for parallax effects.  The sketch keeps ownership of the tileset, palette and map, call setTileset() or setMap()
+    again after changing one in place. */
+template <typename RGB, unsigned int optionFlags>
+class SMLayerTilemap : public SM_Layer {
+    public:
+        SMLayerTilemap(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage);
+        void setRotation(rotationDegrees newrotation);
+
+        void enableColorCorrection(bool enabled);
+
+        // tiles is consecutive tileSize x tileSize tiles (tileSize is 8 or 16), palette has an entry for every index used
+        void setTileset(const uint8_t * tiles, uint8_t tileSize, const RGB * palette, int16_t transparentIndex = SM_TILEMAP_NO_TRANSPARENCY);
+        // map is mapWidth x mapHeight tile indexes
+        void setMap(const uint8_t * map, uint16_t mapWidth, uint16_t mapHeight);
+        // the map pixel drawn at local (0,0)
+        void setScroll(int16_t x, int16_t y);
+        // added to the horizontal scroll for local row y
+        void setRowScroll(uint16_t y, int16_t x);
+
+    protected:
+        typedef struct tilemapState {
+            const uint8_t * tiles;
+            const RGB * palette;
+            const uint8_t * map;
+            uint16_t mapWidth, mapHeight;
+            int16_t scrollX, scrollY;
+            int16_t transparentIndex;
+            uint8_t tileShift;
+        } tilemapState;
+
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void fillTilePixel(uint8_t paletteIndex, RGB_OUT &pixel);
+        void beginStateUpdate(void);
+        void endStateUpdate(void);
+
+        // the sketch updates drawState, frameRefreshCallback() copies it to refreshState when tilemapChanged is set
+        tilemapState drawState;
+        tilemapState refreshState;
+        volatile bool tilemapChanged = true;
+        // setters increment tilemapUpdates before and after writing drawState or drawRowScroll, it's odd while they're being written
+        volatile uint8_t tilemapUpdates = 0;
+
+        // one entry per local row, sized for either orientation
+        int16_t * drawRowScroll = NULL;
+        int16_t * refreshRowScroll = NULL;
+        uint16_t rowScrollSize;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+};
+
+#include "Layer_Tilemap_Impl.h"
+
+#endif
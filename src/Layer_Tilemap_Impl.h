@@ -0,0 +1,280 @@
+/*
+ * SmartMatrix Library - Tilemap Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+// returns coordinate wrapped to 0..size-1
+static inline int wrapTilemapCoordinate(int coordinate, int size) {
+    coordinate %= size;
+    return (coordinate < 0) ? coordinate + size : coordinate;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerTilemap<RGB, optionFlags>::SMLayerTilemap(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    rowScrollSize = max(width, height);
+    memset((void *)&drawState, 0x00, sizeof(tilemapState));
+    drawState.transparentIndex = SM_TILEMAP_NO_TRANSPARENCY;
+    refreshState = drawState;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::begin(void) {
+    if(!drawRowScroll) {
+        drawRowScroll = (int16_t *)malloc(sizeof(int16_t) * rowScrollSize);
+        refreshRowScroll = (int16_t *)malloc(sizeof(int16_t) * rowScrollSize);
+#ifdef ESP32
+        assert(drawRowScroll != NULL);
+        assert(refreshRowScroll != NULL);
+#else
+        //this->assert(drawRowScroll != NULL);
+        //this->assert(refreshRowScroll != NULL);
+#endif
+    }
+
+    // without both buffers the layer stays disabled and draws nothing
+    if(!drawRowScroll || !refreshRowScroll) {
+        free(drawRowScroll);
+        free(refreshRowScroll);
+        drawRowScroll = NULL;
+        refreshRowScroll = NULL;
+        return;
+    }
+
+    memset(drawRowScroll, 0x00, sizeof(int16_t) * rowScrollSize);
+    memset(refreshRowScroll, 0x00, sizeof(int16_t) * rowScrollSize);
+    tilemapChanged = true;
+
+    this->beginChangedRowTracking();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->updateColorCorrectionVersion();
+
+    if(!refreshRowScroll)
+        return;
+
+    // skip the copy while a setter is part way through, and discard a copy a setter wrote into, so refreshState never pairs
+    // a new map or tileset pointer with the previous sizes
+    uint8_t updates = tilemapUpdates;
+    if(tilemapChanged && !(updates & 1)) {
+        // clear the flag before copying, so an update made during the copy is picked up next frame
+        tilemapChanged = false;
+
+        __sync_synchronize();
+        tilemapState state = drawState;
+        memcpy(refreshRowScroll, drawRowScroll, sizeof(int16_t) * rowScrollSize);
+        __sync_synchronize();
+
+        if(tilemapUpdates == updates) {
+            refreshState = state;
+        } else {
+            tilemapChanged = true;
+        }
+
+        // any change to the tilemap can move every row
+        this->markAllRefreshRowsChanged();
+    }
+
+    this->updateRefreshRowsChanged(false);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+inline void SMLayerTilemap<RGB, optionFlags>::fillTilePixel(uint8_t paletteIndex, RGB_OUT &pixel) {
+    if(paletteIndex == refreshState.transparentIndex)
+        return;
+
+    if(ccEnabled)
+        colorCorrection(refreshState.palette[paletteIndex], pixel);
+    else
+        pixel = refreshState.palette[paletteIndex];
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SMLayerTilemap<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    const tilemapState &state = refreshState;
+
+    if(!state.tiles || !state.palette || !state.map || !refreshRowScroll)
+        return;
+
+    int i, localX, localY, step, mapX, mapY;
+    int tileShift = state.tileShift;
+    int tileMask = (1 << tileShift) - 1;
+    int mapPixelWidth = state.mapWidth << tileShift;
+    int mapPixelHeight = state.mapHeight << tileShift;
+
+    // find the local pixel at hardware x 0, and the step through local x or y for each hardware pixel
+    if (this->layerRotation == rotation0) {
+        localX = 0;
+        localY = hardwareY;
+        step = 1;
+    } else if (this->layerRotation == rotation180) {
+        localX = this->matrixWidth - 1;
+        localY = (this->matrixHeight - 1) - hardwareY;
+        step = -1;
+    } else if (this->layerRotation == rotation90) {
+        localX = hardwareY;
+        localY = this->matrixWidth - 1;
+        step = -1;
+    } else { /* if (layerRotation == rotation270)*/
+        localX = (this->matrixHeight - 1) - hardwareY;
+        localY = 0;
+        step = 1;
+    }
+
+    if (this->layerRotation == rotation0 || this->layerRotation == rotation180) {
+        // the hardware row is a local row, walk along one row of tiles
+        mapX = wrapTilemapCoordinate(localX + state.scrollX + refreshRowScroll[localY], mapPixelWidth);
+        mapY = wrapTilemapCoordinate(localY + state.scrollY, mapPixelHeight);
+
+        const uint8_t * mapRow = &state.map[(mapY >> tileShift) * state.mapWidth];
+        const uint8_t * tileRow = &state.tiles[(mapY & tileMask) << tileShift];
+
+        for(i=0; i<this->matrixWidth; i++) {
+            fillTilePixel(tileRow[(mapRow[mapX >> tileShift] << (2 * tileShift)) + (mapX & tileMask)], refreshRow[i]);
+
+            mapX += step;
+            if(mapX == mapPixelWidth)
+                mapX = 0;
+            else if(mapX < 0)
+                mapX = mapPixelWidth - 1;
+        }
+    } else {
+        // the hardware row is a local column, walk down one column of tiles, each local row has its own horizontal scroll
+        mapY = wrapTilemapCoordinate(localY + state.scrollY, mapPixelHeight);
+
+        for(i=0; i<this->matrixWidth; i++) {
+            mapX = wrapTilemapCoordinate(localX + state.scrollX + refreshRowScroll[localY], mapPixelWidth);
+
+            uint8_t tile = state.map[((mapY >> tileShift) * state.mapWidth) + (mapX >> tileShift)];
+            fillTilePixel(state.tiles[(tile << (2 * tileShift)) + ((mapY & tileMask) << tileShift) + (mapX & tileMask)], refreshRow[i]);
+
+            localY += step;
+            mapY += step;
+            if(mapY == mapPixelHeight)
+                mapY = 0;
+            else if(mapY < 0)
+                mapY = mapPixelHeight - 1;
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::getRowCoverage(uint16_t hardwareY, layerRowCoverage &coverage) {
+    coverage.drawsPixels = refreshState.tiles && refreshState.palette && refreshState.map && refreshRowScroll;
+
+    // without a transparent index every pixel in the row is drawn
+    if(coverage.drawsPixels && refreshState.transparentIndex == SM_TILEMAP_NO_TRANSPARENCY) {
+        coverage.opaqueFirstX = 0;
+        coverage.opaqueEndX = this->matrixWidth;
+    } else {
+        coverage.opaqueFirstX = 0;
+        coverage.opaqueEndX = 0;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    tilemapChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    bool newCcEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    if(newCcEnabled != this->ccEnabled)
+        this->markAllRefreshRowsChanged();
+
+    this->ccEnabled = newCcEnabled;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::setTileset(const uint8_t * tiles, uint8_t tileSize, const RGB * palette, int16_t transparentIndex) {
+    if(tileSize != 8 && tileSize != 16)
+        return;
+
+    beginStateUpdate();
+    drawState.tiles = tiles;
+    drawState.tileShift = (tileSize == 8) ? 3 : 4;
+    drawState.palette = palette;
+    drawState.transparentIndex = transparentIndex;
+    endStateUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::setMap(const uint8_t * map, uint16_t mapWidth, uint16_t mapHeight) {
+    if(!mapWidth || !mapHeight)
+        return;
+
+    beginStateUpdate();
+    drawState.map = map;
+    drawState.mapWidth = mapWidth;
+    drawState.mapHeight = mapHeight;
+    endStateUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::setScroll(int16_t x, int16_t y) {
+    beginStateUpdate();
+    drawState.scrollX = x;
+    drawState.scrollY = y;
+    endStateUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTilemap<RGB, optionFlags>::setRowScroll(uint16_t y, int16_t x) {
+    if(y >= rowScrollSize || !drawRowScroll)
+        return;
+
+    beginStateUpdate();
+    drawRowScroll[y] = x;
+    endStateUpdate();
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerTilemap<RGB, optionFlags>::beginStateUpdate(void) {
+    tilemapUpdates++;
+    __sync_synchronize();
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerTilemap<RGB, optionFlags>::endStateUpdate(void) {
+    __sync_synchronize();
+    tilemapUpdates++;
+    tilemapChanged = true;
+}
@@ -0,0 +1,246 @@
+/*
+ * SmartMatrix Library - Calculation Pipeline Profiler
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MatrixCalcProfiler_h
+#define MatrixCalcProfiler_h
+
+/*  Define SMARTMATRIX_CALC_PROFILING at the top of the sketch (before including SmartMatrix.h) to time each stage of
+    the calc pipeline.  Time spent in each stage is summed over a refresh frame, and the per-frame totals are kept as
+    last/min/max/average and a histogram, readable from the sketch with SmartMatrixCalcProfiler::getStats().  Layer
+    stages are recorded separately for each layer, pass the layer to getStats() to read them.  Without
+    SMARTMATRIX_CALC_PROFILING, the macros used by the calc classes compile to nothing. */
+
+typedef enum calcProfileStage {
+    calcStageFrameRefreshCallback,  // each layer's frameRefreshCallback()
+    calcStageFillRefreshRow,        // each layer's fillRefreshRow()/fillRefreshPixels()
+    calcStageBitplanePacking,       // converting the filled rows to refresh buffer data, recorded including fillRefreshRow() and reported without it
+    calcStageBufferHandoff,         // writeFrameBuffer()/writeRowBuffer()
+    calcStageCount
+} calcProfileStage;
+
+#ifdef SMARTMATRIX_CALC_PROFILING
+
+// layers are tracked in the order their frameRefreshCallback() is first recorded, any layers past the limit share the last slot
+#ifndef SM_CALC_PROFILE_MAX_LAYERS
+#define SM_CALC_PROFILE_MAX_LAYERS          8
+#endif
+
+// tasks that can record at the same time: the ESP32 calc task and dual core worker task
+#define SM_CALC_PROFILE_MAX_CONTEXTS        2
+
+// bin 0 counts frames that took 0us, bin n counts frames that took 2^(n-1) to 2^n - 1 microseconds, the last bin counts everything longer
+#define SM_CALC_PROFILE_HISTOGRAM_BINS      16
+
+#if defined(ESP32)
+    #define SM_CALC_PROFILE_TICKS()             ESP.getCycleCount()
+    #define SM_CALC_PROFILE_TICKS_PER_MICRO     ESP.getCpuFreqMHz()
+#elif defined(__IMXRT1062__)
+    #define SM_CALC_PROFILE_TICKS()             ARM_DWT_CYCCNT
+    #define SM_CALC_PROFILE_TICKS_PER_MICRO     (F_CPU_ACTUAL / 1000000)
+#else
+    // Teensy 3 doesn't enable the cycle counter by default, and host builds only need to provide micros()
+    #define SM_CALC_PROFILE_TICKS()             micros()
+    #define SM_CALC_PROFILE_TICKS_PER_MICRO     1
+#endif
+
+#define SM_CALC_PROFILE_START(name)                         uint32_t name = SM_CALC_PROFILE_TICKS()
+#define SM_CALC_PROFILE_ELAPSED(name)                       (SM_CALC_PROFILE_TICKS() - name)
+#define SM_CALC_PROFILE_ADD(stage, layer, context, ticks)   SmartMatrixCalcProfiler::addTicks(stage, layer, context, ticks)
+#define SM_CALC_PROFILE_BEGIN_FRAME()                       SmartMatrixCalcProfiler::beginFrame()
+#define SM_CALC_PROFILE_END_FRAME()                         SmartMatrixCalcProfiler::endFrame()
+
+typedef struct calcProfileStats {
+    uint32_t lastMicros;
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint32_t averageMicros;
+    uint32_t frames;
+    uint32_t histogram[SM_CALC_PROFILE_HISTOGRAM_BINS];
+} calcProfileStats;
+
+// use a dummy template, as a way to allow class to be defined in header and not separate .cpp file (the .cpp wouldn't see the sketch's #define)
+template <int dummyvar>
+class SmartMatrixCalcProfilerBase {
+public:
+    // called by the calc classes
+    static void beginFrame(void);
+    static void addTicks(calcProfileStage stage, SM_Layer * layer, int context, uint32_t ticks);
+    static void endFrame(void);
+
+    // returns false if the stage hasn't been recorded for this layer yet, use layer = NULL for stages that aren't per-layer
+    static bool getStats(calcProfileStage stage, SM_Layer * layer, calcProfileStats * stats);
+    static void reset(void);
+
+private:
+    static int addLayerSlot(SM_Layer * layer);
+    static int findLayerSlot(SM_Layer * layer);
+
+    static SM_Layer * layers[SM_CALC_PROFILE_MAX_LAYERS];
+    static uint32_t frameTicks[SM_CALC_PROFILE_MAX_CONTEXTS][calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+    static bool frameRecorded[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+    static uint64_t totalMicros[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+    static calcProfileStats stats[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+};
+
+typedef SmartMatrixCalcProfilerBase<0> SmartMatrixCalcProfiler;
+
+template <int dummyvar> SM_Layer * SmartMatrixCalcProfilerBase<dummyvar>::layers[SM_CALC_PROFILE_MAX_LAYERS];
+template <int dummyvar> uint32_t SmartMatrixCalcProfilerBase<dummyvar>::frameTicks[SM_CALC_PROFILE_MAX_CONTEXTS][calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+template <int dummyvar> bool SmartMatrixCalcProfilerBase<dummyvar>::frameRecorded[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+template <int dummyvar> uint64_t SmartMatrixCalcProfilerBase<dummyvar>::totalMicros[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+template <int dummyvar> calcProfileStats SmartMatrixCalcProfilerBase<dummyvar>::stats[calcStageCount][SM_CALC_PROFILE_MAX_LAYERS];
+
+// only called for calcStageFrameRefreshCallback, which is recorded from the calc task before the rows of the frame are filled, so
+// the dual core worker never writes layers[]
+template <int dummyvar>
+int SmartMatrixCalcProfilerBase<dummyvar>::addLayerSlot(SM_Layer * layer) {
+    int slot = findLayerSlot(layer);
+    if(slot >= 0)
+        return slot;
+
+    for(slot=1; layers[slot]; slot++);
+    layers[slot] = layer;
+    return slot;
+}
+
+// returns -1 for a layer that hasn't been added yet while there are free slots
+template <int dummyvar>
+int SmartMatrixCalcProfilerBase<dummyvar>::findLayerSlot(SM_Layer * layer) {
+    // slot 0 is used for stages that aren't per-layer
+    if(!layer)
+        return 0;
+
+    int i;
+    for(i=1; i<SM_CALC_PROFILE_MAX_LAYERS && layers[i]; i++) {
+        if(layers[i] == layer)
+            return i;
+    }
+
+    if(i == SM_CALC_PROFILE_MAX_LAYERS)
+        return SM_CALC_PROFILE_MAX_LAYERS - 1;
+
+    return -1;
+}
+
+template <int dummyvar>
+void SmartMatrixCalcProfilerBase<dummyvar>::beginFrame(void) {
+    memset(frameTicks, 0x00, sizeof(frameTicks));
+    memset(frameRecorded, 0x00, sizeof(frameRecorded));
+}
+
+template <int dummyvar>
+void SmartMatrixCalcProfilerBase<dummyvar>::addTicks(calcProfileStage stage, SM_Layer * layer, int context, uint32_t ticks) {
+    int slot = (stage == calcStageFrameRefreshCallback) ? addLayerSlot(layer) : findLayerSlot(layer);
+    if(slot < 0)
+        return;
+
+    frameTicks[context][stage][slot] += ticks;
+    frameRecorded[stage][slot] = true;
+}
+
+template <int dummyvar>
+void SmartMatrixCalcProfilerBase<dummyvar>::endFrame(void) {
+    uint32_t ticksPerMicro = SM_CALC_PROFILE_TICKS_PER_MICRO;
+
+    for(int stage=0; stage<calcStageCount; stage++) {
+        for(int slot=0; slot<SM_CALC_PROFILE_MAX_LAYERS; slot++) {
+            if(!frameRecorded[stage][slot])
+                continue;
+
+            // stage time is the CPU time used by all contexts, not the wall clock time
+            uint32_t ticks = 0;
+            for(int context=0; context<SM_CALC_PROFILE_MAX_CONTEXTS; context++) {
+                uint32_t contextTicks = frameTicks[context][stage][slot];
+
+                // the layers fill rows from inside the packing loop, take their time out of the packing time
+                if(stage == calcStageBitplanePacking) {
+                    uint32_t fillTicks = 0;
+                    for(int i=0; i<SM_CALC_PROFILE_MAX_LAYERS; i++)
+                        fillTicks += frameTicks[context][calcStageFillRefreshRow][i];
+
+                    contextTicks = (contextTicks > fillTicks) ? contextTicks - fillTicks : 0;
+                }
+
+                ticks += contextTicks;
+            }
+
+            uint32_t frameMicros = ticks / ticksPerMicro;
+            calcProfileStats * s = &stats[stage][slot];
+
+            if(!s->frames || frameMicros < s->minMicros)
+                s->minMicros = frameMicros;
+            if(frameMicros > s->maxMicros)
+                s->maxMicros = frameMicros;
+
+            s->lastMicros = frameMicros;
+            s->frames++;
+            totalMicros[stage][slot] += frameMicros;
+            s->averageMicros = totalMicros[stage][slot] / s->frames;
+
+            int bin = 0;
+            while(frameMicros && bin < SM_CALC_PROFILE_HISTOGRAM_BINS - 1) {
+                frameMicros >>= 1;
+                bin++;
+            }
+            s->histogram[bin]++;
+        }
+    }
+}
+
+template <int dummyvar>
+bool SmartMatrixCalcProfilerBase<dummyvar>::getStats(calcProfileStage stage, SM_Layer * layer, calcProfileStats * stats) {
+    if(stage >= calcStageCount)
+        return false;
+
+    int slot = 0;
+    if(layer) {
+        for(slot=1; slot<SM_CALC_PROFILE_MAX_LAYERS; slot++) {
+            if(layers[slot] == layer)
+                break;
+        }
+        if(slot == SM_CALC_PROFILE_MAX_LAYERS)
+            return false;
+    }
+
+    // copy with the calc running, a frame may finish partway through the copy
+    *stats = SmartMatrixCalcProfilerBase<dummyvar>::stats[stage][slot];
+    return stats->frames > 0;
+}
+
+template <int dummyvar>
+void SmartMatrixCalcProfilerBase<dummyvar>::reset(void) {
+    memset(stats, 0x00, sizeof(stats));
+    memset(totalMicros, 0x00, sizeof(totalMicros));
+}
+
+#else
+
+#define SM_CALC_PROFILE_START(name)
+#define SM_CALC_PROFILE_ELAPSED(name)
+#define SM_CALC_PROFILE_ADD(stage, layer, context, ticks)
+#define SM_CALC_PROFILE_BEGIN_FRAME()
+#define SM_CALC_PROFILE_END_FRAME()
+
+#endif
+
+#endif
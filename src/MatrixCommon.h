@@ -25,6 +25,8 @@
 #define _MATRIX_COMMON_H_
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef ARDUINO_ARCH_AVR
 #include "Arduino.h"
@@ -973,31 +975,381 @@ static const PROGMEM uint16_t lightPowerMap12to16bit[4096] = {
       0xfebf,0xfee7,0xff0f,0xff37,0xff5f,0xff87,0xffaf,0xffd7
 };
 
-inline void calculate8BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness) {
-    // update background table
-    for(int i=0; i<256; i++)
-        lut[i] = (lightPowerMap16bit[i] * backgroundBrightness) / 256;
+// settings for the color correction curves shared by all layers, see SmartMatrixColorCorrection::setCorrection()
+typedef struct colorCorrectionSettings {
+    // gamma * 256 (e.g. 563 for 2.2), 0 uses the 2.5 gamma tables above
+    uint16_t gamma;
+    // per-channel gain for white balance, 256 is full scale
+    uint16_t redGain, greenGain, blueGain;
+    // lowest 16-bit output for inputs above zero, for LEDs that don't light at very short on times
+    uint16_t blackLevel;
+    // white point in Kelvin (1000-12000) applied on top of the gains, 0 or 6500 leaves white unchanged
+    uint16_t colorTemperature;
+} colorCorrectionSettings;
+
+#define SM_COLOR_CORRECTION_DEFAULTS    { 0, 256, 256, 256, 0, 0 }
+
+// background layers that can get green and blue LUTs of their own, see addBackgroundChannelLUTs()
+#ifndef SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS
+#define SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS   4
+#endif
+
+// 2^(2^(n-16)) in 2.30 fixed point, multiplied together for the fraction bits in exp2
+static const uint32_t colorCorrectionExp2Fractions[16] = {
+    1073753181, 1073764537, 1073787251, 1073832680, 1073923544, 1074105294, 1074468888, 1075196443,
+    1076653033, 1079572136, 1085434106, 1097253708, 1121280436, 1170923762, 1276901417, 1518500250
+};
+
+// red, green and blue gain for 1000K to 12000K in 500K steps, normalized to 6500K and so the largest gain is 256
+// calculated from Tanner Helland's blackbody color approximation
+static const uint16_t colorTemperatureGains[23][3] = {
+    {256,  68,   0}, {256, 109,   0}, {256, 138,  14}, {256, 160,  72}, {256, 179, 113}, {256, 194, 144},
+    {256, 207, 170}, {256, 219, 192}, {256, 230, 211}, {256, 239, 228}, {256, 248, 242}, {256, 256, 256},
+    {239, 239, 256}, {226, 232, 256}, {218, 227, 256}, {211, 223, 256}, {206, 220, 256}, {202, 218, 256},
+    {199, 215, 256}, {195, 214, 256}, {193, 212, 256}, {190, 210, 256}, {188, 209, 256}
+};
+
+/*  Builds the color correction curves used by all layers.  With default settings the curves are the tables above and no RAM is
+    used, other settings build a 256-entry table per channel in RAM.  Each curve is the gamma curve (calculated in fixed point
+    with log2 and exp2, or read from the tables when gamma is 0) raised to the black level, then scaled by the channel's gain and
+    color temperature multiplier.  Background layers build their own brightness-scaled LUTs from the same curves, a single LUT
+    for all channels unless the channel gains differ.  Layers that cache corrected colors or track changed rows compare
+    getVersion() once per frame. */
+template <int dummyvar>
+class SmartMatrixColorCorrectionBase {
+public:
+    static void setCorrection(const colorCorrectionSettings &newSettings);
+    static void resetCorrection(void);
+    static const colorCorrectionSettings & getCorrection(void) { return settings; };
+    // changes every time the curves change
+    static uint8_t getVersion(void) { return version; };
+
+    // 16-bit corrected value of an 8-bit input for channel 0 (red), 1 (green) or 2 (blue)
+    static uint16_t correctChannel(int channel, uint8_t value) { return channelLUTs[channel][value]; };
+    // true when the channels have different gains, so background layers need a LUT per channel
+    static bool hasChannelGains(void);
+    /*  Background layers register where to keep their green and blue LUTs (1 << inputBits entries each, inputBits is 8 or
+        12).  The LUTs are allocated from the user's context the first time the channel gains differ, so the refresh
+        callbacks never allocate.  *channelLUTs stays NULL if the gains never differ, or if there's no room */
+    static void addBackgroundChannelLUTs(color_chan_t ** channelLUTs, int inputBits);
+    /*  Points luts[] at the red, green and blue LUTs for a background layer and fills them, scaled by brightness/256.  lut
+        (1 << inputBits entries) is used for all three channels unless the channel gains differ and channelLUTs was
+        allocated by addBackgroundChannelLUTs(), then it holds red and channelLUTs holds green and blue */
+    static void calculateBackgroundLUT(const color_chan_t * luts[3], color_chan_t * lut, color_chan_t * channelLUTs, int inputBits, uint8_t brightness);
+
+private:
+    static bool isDefaultCorrection(void);
+    static void allocateBackgroundChannelLUTs(void);
+    static color_chan_t getBackgroundLUTValue(uint32_t curve, uint16_t gain, uint8_t brightness);
+    static void getChannelGains(uint16_t gains[3]);
+    static uint32_t getCurveValue(uint32_t value, int inputBits);
+    static int32_t log2Fixed(uint32_t value);
+    static uint32_t exp2Fixed(int32_t exponent);
+
+    static colorCorrectionSettings settings;
+    static volatile uint8_t version;
+    static const uint16_t * channelLUTs[3];
+    static uint16_t * customLUTs;
+    static color_chan_t ** backgroundChannelLUTs[SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS];
+    static uint8_t backgroundChannelLUTInputBits[SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS];
+    static uint8_t numBackgroundChannelLUTs;
+};
+
+typedef SmartMatrixColorCorrectionBase<0> SmartMatrixColorCorrection;
+
+template <int dummyvar>
+colorCorrectionSettings SmartMatrixColorCorrectionBase<dummyvar>::settings = SM_COLOR_CORRECTION_DEFAULTS;
+template <int dummyvar>
+volatile uint8_t SmartMatrixColorCorrectionBase<dummyvar>::version = 0;
+template <int dummyvar>
+const uint16_t * SmartMatrixColorCorrectionBase<dummyvar>::channelLUTs[3] = { lightPowerMap16bit, lightPowerMap16bit, lightPowerMap16bit };
+template <int dummyvar>
+uint16_t * SmartMatrixColorCorrectionBase<dummyvar>::customLUTs = NULL;
+template <int dummyvar>
+color_chan_t ** SmartMatrixColorCorrectionBase<dummyvar>::backgroundChannelLUTs[SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS];
+template <int dummyvar>
+uint8_t SmartMatrixColorCorrectionBase<dummyvar>::backgroundChannelLUTInputBits[SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS];
+template <int dummyvar>
+uint8_t SmartMatrixColorCorrectionBase<dummyvar>::numBackgroundChannelLUTs = 0;
+
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::setCorrection(const colorCorrectionSettings &newSettings) {
+    settings = newSettings;
+
+    if(isDefaultCorrection()) {
+        for(int c=0; c<3; c++)
+            channelLUTs[c] = lightPowerMap16bit;
+    } else {
+        if(!customLUTs) {
+            customLUTs = (uint16_t *)malloc(sizeof(uint16_t) * 3 * 256);
+            // keep the current curves if there's no room for new ones
+            if(!customLUTs)
+                return;
+        }
+
+        uint16_t gains[3];
+        getChannelGains(gains);
+
+        for(int i=0; i<256; i++) {
+            uint32_t curve = getCurveValue(i, 8);
+
+            for(int c=0; c<3; c++) {
+                uint32_t corrected = (curve * gains[c]) >> 8;
+                customLUTs[(c * 256) + i] = (corrected > 0xFFFF) ? 0xFFFF : corrected;
+            }
+        }
+
+        for(int c=0; c<3; c++)
+            channelLUTs[c] = &customLUTs[c * 256];
+
+        if(hasChannelGains())
+            allocateBackgroundChannelLUTs();
+    }
+
+    version++;
+}
+
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::resetCorrection(void) {
+    const colorCorrectionSettings defaults = SM_COLOR_CORRECTION_DEFAULTS;
+    setCorrection(defaults);
+}
+
+template <int dummyvar>
+bool SmartMatrixColorCorrectionBase<dummyvar>::hasChannelGains(void) {
+    if(isDefaultCorrection())
+        return false;
+
+    uint16_t gains[3];
+    getChannelGains(gains);
+
+    return gains[0] != gains[1] || gains[1] != gains[2];
+}
+
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::addBackgroundChannelLUTs(color_chan_t ** channelLUTs, int inputBits) {
+    if(numBackgroundChannelLUTs == SM_COLOR_CORRECTION_MAX_BACKGROUND_LAYERS)
+        return;
+
+    backgroundChannelLUTs[numBackgroundChannelLUTs] = channelLUTs;
+    backgroundChannelLUTInputBits[numBackgroundChannelLUTs] = inputBits;
+    numBackgroundChannelLUTs++;
+
+    if(hasChannelGains())
+        allocateBackgroundChannelLUTs();
+}
+
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::allocateBackgroundChannelLUTs(void) {
+    for(int i=0; i<numBackgroundChannelLUTs; i++) {
+        if(!*backgroundChannelLUTs[i])
+            *backgroundChannelLUTs[i] = (color_chan_t *)malloc(sizeof(color_chan_t) * 2 * (1 << backgroundChannelLUTInputBits[i]));
+    }
+}
+
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::calculateBackgroundLUT(const color_chan_t * luts[3], color_chan_t * lut, color_chan_t * channelLUTs, int inputBits, uint8_t brightness) {
+    const int numEntries = 1 << inputBits;
+    int i;
+
+    bool perChannel = channelLUTs && hasChannelGains();
+
+    luts[0] = lut;
+    luts[1] = perChannel ? channelLUTs : lut;
+    luts[2] = perChannel ? &channelLUTs[numEntries] : lut;
+
+    if(isDefaultCorrection()) {
+        const uint16_t * curve = (inputBits == 8) ? lightPowerMap16bit : lightPowerMap12to16bit;
+
+        for(i=0; i<numEntries; i++)
+            lut[i] = (curve[i] * brightness) / 256;
+        return;
+    }
+
+    uint16_t gains[3];
+    getChannelGains(gains);
+
+    for(i=0; i<numEntries; i++) {
+        uint32_t curve = getCurveValue(i, inputBits);
+
+        if(perChannel) {
+            lut[i] = getBackgroundLUTValue(curve, gains[0], brightness);
+            channelLUTs[i] = getBackgroundLUTValue(curve, gains[1], brightness);
+            channelLUTs[numEntries + i] = getBackgroundLUTValue(curve, gains[2], brightness);
+        } else {
+            // the gains are the same, or there was no room for channelLUTs and green stands in for all three
+            lut[i] = getBackgroundLUTValue(curve, gains[1], brightness);
+        }
+    }
+}
+
+template <int dummyvar>
+color_chan_t SmartMatrixColorCorrectionBase<dummyvar>::getBackgroundLUTValue(uint32_t curve, uint16_t gain, uint8_t brightness) {
+    uint32_t corrected = (curve * gain) >> 8;
+    if(corrected > 0xFFFF)
+        corrected = 0xFFFF;
+
+    return (corrected * brightness) / 256;
+}
+
+template <int dummyvar>
+bool SmartMatrixColorCorrectionBase<dummyvar>::isDefaultCorrection(void) {
+    return !settings.gamma && settings.redGain == 256 && settings.greenGain == 256 && settings.blueGain == 256 &&
+        !settings.blackLevel && (!settings.colorTemperature || settings.colorTemperature == 6500);
+}
+
+// per-channel gain and color temperature multiplier combined, 256 is full scale
+template <int dummyvar>
+void SmartMatrixColorCorrectionBase<dummyvar>::getChannelGains(uint16_t gains[3]) {
+    const uint16_t channelGains[3] = { settings.redGain, settings.greenGain, settings.blueGain };
+    int c;
+
+    if(!settings.colorTemperature) {
+        for(c=0; c<3; c++)
+            gains[c] = channelGains[c];
+        return;
+    }
+
+    // interpolate between the 500K steps of colorTemperatureGains
+    int temperature = settings.colorTemperature;
+    if(temperature < 1000)
+        temperature = 1000;
+    if(temperature > 12000)
+        temperature = 12000;
+
+    int index = (temperature - 1000) / 500;
+    int fraction = (temperature - 1000) % 500;
+    if(index == 22) {
+        index = 21;
+        fraction = 500;
+    }
+
+    for(c=0; c<3; c++) {
+        int temperatureGain = colorTemperatureGains[index][c] + (((colorTemperatureGains[index + 1][c] - colorTemperatureGains[index][c]) * fraction) / 500);
+        gains[c] = ((uint32_t)channelGains[c] * temperatureGain) >> 8;
+    }
+}
+
+// 16-bit curve value (before gains) for an input of inputBits bits
+template <int dummyvar>
+uint32_t SmartMatrixColorCorrectionBase<dummyvar>::getCurveValue(uint32_t value, int inputBits) {
+    uint32_t curve;
+
+    if(!value)
+        return 0;
+
+    if(!settings.gamma) {
+        curve = (inputBits == 8) ? lightPowerMap16bit[value] : lightPowerMap12to16bit[value];
+    } else {
+        // (value / maxValue) ^ gamma, the log2 difference is <= 0 so the result is <= 1.0
+        int32_t logRatio = log2Fixed(value) - log2Fixed((1 << inputBits) - 1);
+        curve = exp2Fixed(((int64_t)logRatio * settings.gamma) / 256);
+        if(curve > 0xFFFF)
+            curve = 0xFFFF;
+    }
+
+    return settings.blackLevel + ((curve * (0xFFFF - settings.blackLevel)) / 0xFFFF);
+}
+
+// log2 of value in 16.16 fixed point, value must be > 0
+template <int dummyvar>
+int32_t SmartMatrixColorCorrectionBase<dummyvar>::log2Fixed(uint32_t value) {
+    int msb = 31;
+    while(!(value & (1UL << msb)))
+        msb--;
+
+    int32_t result = msb << 16;
+
+    // normalize to 1.0-2.0 in 2.30 fixed point, each squaring moves the next fraction bit into the integer part
+    uint64_t mantissa = (msb <= 30) ? ((uint64_t)value << (30 - msb)) : (value >> 1);
+    for(int bit=15; bit>=0; bit--) {
+        mantissa = (mantissa * mantissa) >> 30;
+        if(mantissa >= (2ULL << 30)) {
+            mantissa >>= 1;
+            result |= (1 << bit);
+        }
+    }
+
+    return result;
+}
+
+// 2^exponent for exponent <= 0 in 16.16 fixed point, returns 0-65536
+template <int dummyvar>
+uint32_t SmartMatrixColorCorrectionBase<dummyvar>::exp2Fixed(int32_t exponent) {
+    // split into an integer part (rounded down) and a fraction 0-65535
+    int32_t integer = -((-exponent + 0xFFFF) / 0x10000);
+    int32_t fraction = exponent - (integer * 0x10000);
+
+    if(integer < -16)
+        return 0;
+
+    uint64_t result = 1UL << 30;
+    for(int bit=0; bit<16; bit++) {
+        if(fraction & (1 << bit))
+            result = (result * colorCorrectionExp2Fractions[bit]) >> 30;
+    }
+
+    return result >> (14 - integer);
+}
+
+// fills the LUTs (256 entries each) of a background layer, see SmartMatrixColorCorrection::calculateBackgroundLUT()
+inline void calculate8BitBackgroundLUT(const color_chan_t * luts[3], color_chan_t * lut, color_chan_t * channelLUTs, uint8_t backgroundBrightness) {
+    SmartMatrixColorCorrection::calculateBackgroundLUT(luts, lut, channelLUTs, 8, backgroundBrightness);
 }
 
 // We use a 12-bit gamma correction table for RGB48, even though there's 16 bits per pixel - a 16-bit table would take up too much RAM and CPU
-inline void calculate12BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness) {
-    // update background table
-    for(int i=0; i<4096; i++)
-        lut[i] = (lightPowerMap12to16bit[i] * backgroundBrightness) / 256;
+// fills the LUTs (4096 entries each) of a background layer, see SmartMatrixColorCorrection::calculateBackgroundLUT()
+inline void calculate12BitBackgroundLUT(const color_chan_t * luts[3], color_chan_t * lut, color_chan_t * channelLUTs, uint8_t backgroundBrightness) {
+    SmartMatrixColorCorrection::calculateBackgroundLUT(luts, lut, channelLUTs, 12, backgroundBrightness);
 }
 
 template <typename RGB_IN>
 void colorCorrection(const RGB_IN& in, rgb48& out) {
-    out.red = lightPowerMap16bit[in.red];
-    out.green = lightPowerMap16bit[in.green];
-    out.blue = lightPowerMap16bit[in.blue];
+    out.red = SmartMatrixColorCorrection::correctChannel(0, in.red);
+    out.green = SmartMatrixColorCorrection::correctChannel(1, in.green);
+    out.blue = SmartMatrixColorCorrection::correctChannel(2, in.blue);
 }
 
 template <typename RGB_IN>
 void colorCorrection(const RGB_IN& in, rgb24& out) {
-    out.red = lightPowerMap16bit[in.red] >> 8;
-    out.green = lightPowerMap16bit[in.green] >> 8;
-    out.blue = lightPowerMap16bit[in.blue] >> 8;
+    out.red = SmartMatrixColorCorrection::correctChannel(0, in.red) >> 8;
+    out.green = SmartMatrixColorCorrection::correctChannel(1, in.green) >> 8;
+    out.blue = SmartMatrixColorCorrection::correctChannel(2, in.blue) >> 8;
+}
+
+// fills a span of pixels with color, storing a 12-byte repeating pattern (4x rgb24, 2x rgb48, 6x rgb16) a word at a time
+template <typename RGB>
+inline void fillColorSpan(RGB * dst, uint16_t numPixels, const RGB& color) {
+    const int patternPixels = 12 / sizeof(RGB);
+
+    if(!(12 % sizeof(RGB)) && numPixels >= patternPixels) {
+        uint32_t pattern[3];
+        for(int i=0; i<patternPixels; i++)
+            memcpy((uint8_t *)pattern + (i * sizeof(RGB)), &color, sizeof(RGB));
+
+        // memcpy lets the compiler use word stores where the target allows unaligned access
+        uint8_t * out = (uint8_t *)dst;
+        for(; numPixels >= patternPixels; numPixels -= patternPixels) {
+            memcpy(out, pattern, sizeof(pattern));
+            out += sizeof(pattern);
+        }
+        dst = (RGB *)out;
+    }
+
+    while(numPixels--)
+        *dst++ = color;
+}
+
+// copies a span of pixels, converting between color depths
+template <typename RGB_OUT, typename RGB_IN>
+inline void copyColorSpan(RGB_OUT * dst, const RGB_IN * src, uint16_t numPixels) {
+    while(numPixels--)
+        *dst++ = *src++;
+}
+
+template <typename RGB>
+inline void copyColorSpan(RGB * dst, const RGB * src, uint16_t numPixels) {
+    memcpy((void *)dst, (const void *)src, sizeof(RGB) * numPixels);
 }
 
 void calculate8BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness);
@@ -109,6 +109,8 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
 #endif
             // do once-per-frame updates
             if (!currentRow) {
+                SM_CALC_PROFILE_BEGIN_FRAME();
+
                 if (rotationChange) {
                     SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                     while(templayer) {
@@ -123,7 +125,9 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
                     if(refreshRateChanged) {
                         templayer->setRefreshRate(refreshRate);
                     }
+                    SM_CALC_PROFILE_START(callbackStartTicks);
                     templayer->frameRefreshCallback();
+                    SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, templayer, 0, SM_CALC_PROFILE_ELAPSED(callbackStartTicks));
                     templayer = templayer->nextLayer;
                 }
                 refreshRateChanged = false;
@@ -132,7 +136,10 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
             // do once-per-line updates
             // none right now
 
+            // loadMatrixBuffers() fills the row through the compositor, which records the fill separately
+            SM_CALC_PROFILE_START(packStartTicks);
             SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(currentRowDataPtr, currentRow);
+            SM_CALC_PROFILE_ADD(calcStageBitplanePacking, NULL, 0, SM_CALC_PROFILE_ELAPSED(packStartTicks));
 
 #ifdef DEBUG_PINS_ENABLED
 //    digitalWriteFast(DEBUG_PIN_3, LOW);
@@ -141,7 +148,12 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
             // enqueue row
             if (++currentRow >= matrixHeight) {
                 currentRow = 0;
+
+                SM_CALC_PROFILE_START(handoffStartTicks);
                 SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(currentRow);
+                SM_CALC_PROFILE_ADD(calcStageBufferHandoff, NULL, 0, SM_CALC_PROFILE_ELAPSED(handoffStartTicks));
+
+                SM_CALC_PROFILE_END_FRAME();
             }
 
         } while (currentRow);
@@ -246,15 +258,8 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[matrixWidth];
 
-    // clear buffer to prevent garbage data showing through transparent layers
-    memset((void *)tempRow0, 0x00, sizeof(tempRow0));
-
-    // get pixel data from layers
-    SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-    while(templayer) {
-        templayer->fillRefreshRow(currentRow, &tempRow0[0]);
-        templayer = templayer->nextLayer;        
-    }
+    // get pixel data from layers, the compositor clears the pixels no layer covers
+    SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, currentRow, matrixWidth, &tempRow0[0]);
 
     if(!currentRow) {
         // fill start and end frame markers
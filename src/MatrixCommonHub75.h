@@ -155,6 +155,10 @@
 
 #define PIXELS_PER_LATCH    ((matrixWidth * matrixHeight) / MATRIX_PANEL_HEIGHT * PHYSICAL_ROWS_PER_REFRESH_ROW)
 
+// panels are numbered left to right, then top to bottom, in unrotated matrix coordinates
+#define MATRIX_PANELS_PER_ROW   ((matrixWidth + COLS_PER_PANEL - 1) / COLS_PER_PANEL)
+#define MATRIX_NUM_PANELS       (MATRIX_PANELS_PER_ROW * MATRIX_STACK_HEIGHT)
+
 #define SM_HUB75_OPTIONS_NONE                       0
 #define SM_HUB75_OPTIONS_C_SHAPE_STACKING           (1 << 0)
 #define SM_HUB75_OPTIONS_BOTTOM_TO_TOP_STACKING     (1 << 1)
@@ -164,6 +168,9 @@
 #define SM_HUB75_OPTIONS_ESP32_CALC_TASK_CORE_1     (1 << 5)
 #define SM_HUB75_OPTIONS_FM6126A_RESET_AT_START     (1 << 6)
 #define SM_HUB75_OPTIONS_T4_CLK_PIN_ALT             (1 << 7)
+#define SM_HUB75_OPTIONS_ESP32_DUAL_CORE_CALC       (1 << 8)
+#define SM_HUB75_OPTIONS_TEMPORAL_DITHERING         (1 << 9)
+#define SM_HUB75_OPTIONS_SPATIAL_DITHERING          (1 << 10)
 
 // old naming convention kept for compatibility
 #define SMARTMATRIX_OPTIONS_NONE                    SM_HUB75_OPTIONS_NONE                   
@@ -175,7 +182,20 @@
 #define SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1  SM_HUB75_OPTIONS_ESP32_CALC_TASK_CORE_1 
 #define SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START  SM_HUB75_OPTIONS_FM6126A_RESET_AT_START 
 #define SMARTMATRIX_OPTIONS_T4_CLK_PIN_ALT          SM_HUB75_OPTIONS_T4_CLK_PIN_ALT         
+#define SMARTMATRIX_OPTIONS_ESP32_DUAL_CORE_CALC    SM_HUB75_OPTIONS_ESP32_DUAL_CORE_CALC   
+#define SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING      SM_HUB75_OPTIONS_TEMPORAL_DITHERING     
+#define SMARTMATRIX_OPTIONS_SPATIAL_DITHERING       SM_HUB75_OPTIONS_SPATIAL_DITHERING      
+
+
+// gain and offset for one panel in a multi-panel matrix, see setPanelCalibration()
+typedef struct panelCalibration {
+    uint8_t     redGain;        // channel is scaled by (gain + 1) / 256, 255 leaves it unchanged
+    uint8_t     greenGain;
+    uint8_t     blueGain;
+    int8_t      offset;         // in 1/256ths of full scale, added to channels that aren't off
+} panelCalibration;
 
+#define SM_PANEL_CALIBRATION_NONE   {255, 255, 255, 0}
 
 // defines data bit order from bit 0-7, four times to fit in uint32_t
 #define PACKED_HUB75_WORD_ORDER p0r1:1, p0g1:1, p0b1:1, p0r2:1, p0g2:1, p0b2:1, p1r1:1, p1g1:1, \
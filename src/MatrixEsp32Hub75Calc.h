@@ -27,6 +27,18 @@
 extern SemaphoreHandle_t calcTaskSemaphore;
 extern void matrixCalculationsSignal(void);
 
+// with SMARTMATRIX_OPTIONS_ESP32_DUAL_CORE_CALC, the calc task packs half the refresh rows and a worker task on the other core packs the rest
+#define ESP32_MAX_CALC_WORKERS      2
+#define ESP32_NUM_CALC_WORKERS      ((optionFlags & SMARTMATRIX_OPTIONS_ESP32_DUAL_CORE_CALC) ? ESP32_MAX_CALC_WORKERS : 1)
+
+// stack size in bytes for the calc task and worker, begin() prints how much of it was left unused after the first frame
+#ifndef ESP32_CALC_TASK_STACK_SIZE
+#define ESP32_CALC_TASK_STACK_SIZE  2048
+#endif
+
+// 24-bit color is staged in rgb24 temp rows, unless dithering needs the bits below COLOR_DEPTH_BITS
+#define ESP32_CALC_TEMP_ROWS_RGB48  ((COLOR_DEPTH_BITS > 8) || (optionFlags & SMARTMATRIX_OPTIONS_SPATIAL_DITHERING))
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixHub75Calc {
 public:
@@ -43,14 +55,22 @@ public:
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
     void setRefreshRate(uint16_t newRefreshRate);
+    void setPanelCalibration(uint16_t panelIndex, const panelCalibration &calibration);
+    void loadPanelCalibration(const panelCalibration * calibrations);
+    void clearPanelCalibration(void);
+    void setPowerLimit(uint8_t maxLoad);
 
     // get info
     uint16_t getScreenWidth(void) const;
     uint16_t getScreenHeight(void) const;
+    uint16_t getNumPanels(void) const;
     uint16_t getRefreshRate(void);
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
+    uint32_t getDmaRamUsage(void);
     void setMaxCalculationCpuPercentage(uint8_t newMaxCpuPercentage);
+    uint32_t getCalculationTimeMicros(void);
+    uint8_t getCalculationCpuPercentage(void);
 
     // debug
     int countFPS(void);
@@ -64,21 +84,49 @@ public:
 private:
     static SM_Layer * baseLayer;
 
-    static void * tempRow0Ptr;
-    static void * tempRow1Ptr;
+    // each task packing rows needs its own temporary rows
+    static void * tempRow0Ptr[ESP32_MAX_CALC_WORKERS];
+    static void * tempRow1Ptr[ESP32_MAX_CALC_WORKERS];
+
+    // packer working space, kept out of the calc task stacks
+    struct calcWorkerBuffersStruct {
+        uint8_t bitplanes[COLOR_DEPTH_BITS][HUB75_BITPLANE_BLOCK_PIXELS];
+        hub75BitplaneScratch bitplaneScratch;
+        // block of pixels from directRefreshLayer, only the type matching the temp rows is used
+        rgb48 rgb48BlockRow0[HUB75_BITPLANE_BLOCK_PIXELS];
+        rgb48 rgb48BlockRow1[HUB75_BITPLANE_BLOCK_PIXELS];
+        rgb24 rgb24BlockRow0[HUB75_BITPLANE_BLOCK_PIXELS];
+        rgb24 rgb24BlockRow1[HUB75_BITPLANE_BLOCK_PIXELS];
+    };
+    static calcWorkerBuffersStruct calcWorkerBuffers[ESP32_MAX_CALC_WORKERS];
+
+    // OE/LAT bits for each (bitplane, position) and ADDX bits for each row, ORed with RGB bits in loadMatrixBuffers
+    static MATRIX_DATA_STORAGE_TYPE * controlWordTemplates;
+    static MATRIX_DATA_STORAGE_TYPE rowAddressWords[MATRIX_SCAN_MOD];
+    // RGB bits for each color index returned by extractHub75Bitplanes()
+    static MATRIX_DATA_STORAGE_TYPE colorIndexWords[HUB75_COLOR_INDEX_COUNT];
+    // matrix rows to load for each (refresh row, physical row in refresh row, stacked panel), depends only on panelType and stacking options
+    static StackedPanelRowSource stackedPanelRowSources[MATRIX_SCAN_MOD * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
+    // refresh buffer position for each (physical row in refresh row, temp row pixel), the panel map flattened so it isn't walked for every row
+    static uint16_t * refreshBufferPositions;
+    // set when the only layer can fill pixels directly, see SM_Layer::hasRefreshPixels()
+    static SM_Layer * directRefreshLayer;
 
     // functions for refreshing
-    static void loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts = 0);
-    static void loadMatrixBuffers48(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
-    static void loadMatrixBuffers24(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
+    static void loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts = 0, bool allRowsChanged = true);
+    static bool isRefreshRowChanged(int currentRow);
+    static void loadMatrixBufferRows(int worker);
+    static void loadMatrixBuffers48(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0, int worker = 0);
+    static void loadMatrixBuffers24(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0, int worker = 0);
     static void calcTask(void* pvParameters);
-    static void resetMultiRowRefreshMapPosition(void);
-    static void resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void);
-    static void advanceMultiRowRefreshMapToNextRow(void);
-    static void advanceMultiRowRefreshMapToNextPixelGroup(void);
-    static int getMultiRowRefreshRowOffset(void);
-    static int getMultiRowRefreshNumPixelsToMap(void);
-    static int getMultiRowRefreshPixelGroupOffset(void);
+    static void calcWorkerTask(void* pvParameters);
+    static void updateCalcThrottle(uint32_t calcCycles);
+    static void adjustCalcRefreshRateDivider(uint8_t newDivider);
+    static void buildControlWordTemplates(int lsbMsbTransitionBit);
+    static void buildRowAddressWords(void);
+    static void buildColorIndexWords(void);
+    static void buildStackedPanelRowSources(void);
+    static void buildRefreshBufferPositions(void);
     
     // configuration
     static volatile bool brightnessChange;
@@ -91,15 +139,36 @@ private:
     static uint8_t calc_refreshRateDivider;
     static bool dmaBufferUnderrunSinceLastCheck;
     static uint8_t maxCalcCpuPercentage;
+    static uint8_t minCalcRefreshRateDivider;
+    static uint32_t calcCyclesAverage;
+    static uint8_t framesWithCalcHeadroom;
     static bool refreshRateLowered;
     static bool refreshRateChanged;
+    // gain and offset for each panel, applied to the rows before bitplane extraction while panelCalibrationEnabled is set
+    static panelCalibration panelCalibrations[MATRIX_NUM_PANELS];
+    static volatile bool panelCalibrationEnabled;
+    static volatile bool panelCalibrationChange;
+    // automatic brightness limiting, see setPowerLimit()
+    static uint8_t powerLimitMaxLoad;
+    static uint16_t powerLimitScale;
+    static volatile bool powerLimitChange;
+    // sum of the channels loaded into each refresh row, kept for the rows that aren't repacked
+    static uint32_t powerLimitRowSums[MATRIX_SCAN_MOD];
     static uint8_t lsbMsbTransitionBit;
     static TaskHandle_t calcTaskHandle;
-    
-    static int multiRowRefresh_mapIndex_CurrentRowGroups;
-    static int multiRowRefresh_mapIndex_CurrentPixelGroup;
-    static int multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
-    static int multiRowRefresh_NumPanelsAlreadyMapped;
+
+    // frame being loaded by loadMatrixBuffers(), shared with the worker task
+    struct calcWorkerJobStruct {
+        frameStruct * currentFrameDataPtr;
+        frameStruct * previousFrameDataPtr;
+        int lsbMsbTransitionBit;
+        int numBrightnessShifts;
+        bool allRowsChanged;
+    };
+    static calcWorkerJobStruct calcWorkerJob;
+    static TaskHandle_t calcWorkerTaskHandle;
+    static SemaphoreHandle_t calcWorkerStartSemaphore;
+    static SemaphoreHandle_t calcWorkerDoneSemaphore;
 };
 
 #endif
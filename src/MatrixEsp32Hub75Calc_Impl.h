@@ -33,6 +33,16 @@ uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType,
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRateDivider = 2;
 
+// the calc throttle never goes below the divider set with setCalcRefreshRateDivider()
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::minCalcRefreshRateDivider = 2;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcCyclesAverage = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::framesWithCalcHeadroom = 0;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRate = 120/SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRateDivider;
 
@@ -40,38 +50,68 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 SM_Layer * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow0Ptr;
+void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow0Ptr[ESP32_MAX_CALC_WORKERS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow1Ptr;
+void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow1Ptr[ESP32_MAX_CALC_WORKERS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
+typename SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerBuffersStruct SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerBuffers[ESP32_MAX_CALC_WORKERS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunSinceLastCheck = false;
+MATRIX_DATA_STORAGE_TYPE * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::controlWordTemplates;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateLowered = false;
+MATRIX_DATA_STORAGE_TYPE SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowAddressWords[MATRIX_SCAN_MOD];
 
-// set to true initially so all layers get the initial refresh rate
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateChanged = true;
+MATRIX_DATA_STORAGE_TYPE SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::colorIndexWords[HUB75_COLOR_INDEX_COUNT];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::lsbMsbTransitionBit;
+StackedPanelRowSource SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stackedPanelRowSources[MATRIX_SCAN_MOD * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
+uint16_t * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshBufferPositions;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentPixelGroup = -1;
+SM_Layer * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::directRefreshLayer = NULL;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
+panelCalibration SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrations[MATRIX_NUM_PANELS];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrationEnabled = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrationChange = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitMaxLoad = 255;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitScale = 256;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitChange = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitRowSums[MATRIX_SCAN_MOD];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunSinceLastCheck = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateLowered = false;
+
+// set to true initially so all layers get the initial refresh rate
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateChanged = true;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_NumPanelsAlreadyMapped = 0;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::lsbMsbTransitionBit;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Calc(void) {
@@ -116,32 +156,25 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalculations() {
-    static unsigned long lastMillisStart;
-    static unsigned long lastMillisEnd;
     static int refreshFramesSinceLastCalculation = 0;
     SM_Layer * templayer;
     static bool firstRun = true;
+    static int controlWordsBrightness = -1;
+    static int controlWordsLsbMsbTransitionBit = -1;
+    static int frameBrightnessShifts = -1;
 
     if(++refreshFramesSinceLastCalculation < calc_refreshRateDivider)
         return;
 
     refreshFramesSinceLastCalculation = 0;
 
-    // safety check - if using up too much CPU, increase refresh rate divider to give more time for sketch to run
-    unsigned long calculationCpuTime = lastMillisEnd - lastMillisStart;
-    unsigned long totalCpuTime = millis() - lastMillisStart;
-    if(totalCpuTime && ((calculationCpuTime * 100) / totalCpuTime) > SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::maxCalcCpuPercentage) {
-        // increase CPU divider by 1
-        SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcRefreshRateDivider(SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalcRefreshRateDivider() + 1);
-        refreshRateLowered = true;
-    }
-
     // only do calculations if there is free space (should be redundant, as we only get called if there is free space)
     if (!SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameBufferFree())
         return;
 
     templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-    bool refreshNeeded = false;
+    // a new calibration or power limit has to be applied even if no layer changed
+    bool refreshNeeded = panelCalibrationChange || powerLimitChange;
     while(templayer) {
         if(templayer->isLayerChanged())
             refreshNeeded = true;
@@ -152,10 +185,15 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     if(!refreshNeeded && !firstRun)
         return;
 
+    // rows that no layer changed are copied from the previous frame, unless something that affects every row changed
+    bool allRowsChanged = firstRun;
+
     firstRun = false;
 
     // now we know we're actually going to update the frame, keep track of the time we started updating
-    lastMillisStart = millis();
+    uint32_t calcStartCycles = ESP.getCycleCount();
+
+    SM_CALC_PROFILE_BEGIN_FRAME();
 
     // do once-per-frame updates
     if (rotationChange) {
@@ -165,6 +203,18 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
             templayer = templayer->nextLayer;
         }
         rotationChange = false;
+        allRowsChanged = true;
+    }
+
+    if (panelCalibrationChange) {
+        panelCalibrationChange = false;
+        allRowsChanged = true;
+    }
+
+    // rows that were packed while the limit was off don't have a load estimate
+    if (powerLimitChange) {
+        powerLimitChange = false;
+        allRowsChanged = true;
     }
 
     int largestRequestedBrightnessShifts = 0;
@@ -175,7 +225,9 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
             templayer->setRefreshRate(calc_refreshRate);
         }
 
+        SM_CALC_PROFILE_START(callbackStartTicks);
         templayer->frameRefreshCallback();
+        SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, templayer, 0, SM_CALC_PROFILE_ELAPSED(callbackStartTicks));
 
         int tempval = templayer->getRequestedBrightnessShifts();
         if(tempval > largestRequestedBrightnessShifts)
@@ -185,7 +237,7 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     }
     refreshRateChanged = false;
 
-    int tempBrightness = brightness >> largestRequestedBrightnessShifts;
+    int tempBrightness = ((brightness * powerLimitScale) >> 8) >> largestRequestedBrightnessShifts;
 
     // scale the overall brightness to accommodate a layer that has its data stored in non MSB bits
     if(tempBrightness != shiftedBrightness) {
@@ -198,11 +250,87 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
         brightnessChange = false;
     }
 
-    SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts);
+    // OE/LAT timing only changes with brightness or lsbMsbTransitionBit, don't recalculate it for every pixel of every frame.  The calc
+    // refresh rate doesn't affect it, so the throttle adjusting the divider doesn't force every row to be repacked
+    if(controlWordsBrightness != shiftedBrightness || controlWordsLsbMsbTransitionBit != lsbMsbTransitionBit) {
+        buildControlWordTemplates(lsbMsbTransitionBit);
+        controlWordsBrightness = shiftedBrightness;
+        controlWordsLsbMsbTransitionBit = lsbMsbTransitionBit;
+        allRowsChanged = true;
+    }
+
+    if(frameBrightnessShifts != largestRequestedBrightnessShifts) {
+        frameBrightnessShifts = largestRequestedBrightnessShifts;
+        allRowsChanged = true;
+    }
+
+    SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts, allRowsChanged);
+
+    // estimate the load of the frame just loaded, a new limit is applied to the next frame
+    uint32_t powerLimitFrameSum = 0;
+    if(powerLimitMaxLoad < 255) {
+        for(int i=0; i<MATRIX_SCAN_MOD; i++)
+            powerLimitFrameSum += powerLimitRowSums[i];
+
+        // the rows were loaded shifted up by largestRequestedBrightnessShifts, and the refresh brightness shifted down to match
+        powerLimitFrameSum >>= largestRequestedBrightnessShifts;
+    }
+
+    uint16_t newPowerLimitScale = calculateHub75PowerLimitScale(powerLimitFrameSum / (matrixWidth * matrixHeight * COLOR_CHANNELS_PER_PIXEL),
+        brightness, PIXELS_PER_LATCH, powerLimitMaxLoad, powerLimitScale);
+    if(newPowerLimitScale != powerLimitScale) {
+        powerLimitScale = newPowerLimitScale;
+        powerLimitChange = true;
+    }
 
+    SM_CALC_PROFILE_START(handoffStartTicks);
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(0);
+    SM_CALC_PROFILE_ADD(calcStageBufferHandoff, NULL, 0, SM_CALC_PROFILE_ELAPSED(handoffStartTicks));
 
-    lastMillisEnd = millis();
+    SM_CALC_PROFILE_END_FRAME();
+
+    // if using up too much (or much less) CPU than allowed, change refresh rate divider to give more time for sketch to run
+    updateCalcThrottle(ESP.getCycleCount() - calcStartCycles);
+}
+
+// calc time is averaged over roughly 1<<CALC_THROTTLE_AVERAGE_SHIFT calculations, so a single slow frame doesn't change the divider
+#define CALC_THROTTLE_AVERAGE_SHIFT         3
+// the divider is only lowered after the average calc time fits in this percentage of the budget at the lower divider for this many calculations in a row
+#define CALC_THROTTLE_HEADROOM_PERCENT      80
+#define CALC_THROTTLE_HEADROOM_FRAMES       30
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::updateCalcThrottle(uint32_t calcCycles) {
+    calcCyclesAverage += ((int32_t)calcCycles - (int32_t)calcCyclesAverage) >> CALC_THROTTLE_AVERAGE_SHIFT;
+
+    uint16_t refreshRate = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRate();
+    if(!refreshRate)
+        return;
+
+    // CPU cycles the calc can use for each refresh frame while staying under maxCalcCpuPercentage
+    uint64_t budgetCyclesPerFrame = ((uint64_t)ESP.getCpuFreqMHz() * 1000000UL / refreshRate) * maxCalcCpuPercentage / 100;
+    if(!budgetCyclesPerFrame)
+        return;
+
+    // smallest divider that fits the average calc time in the budget
+    uint64_t targetDivider = (calcCyclesAverage + budgetCyclesPerFrame - 1) / budgetCyclesPerFrame;
+    if(targetDivider > 255)
+        targetDivider = 255;
+
+    if(targetDivider > calc_refreshRateDivider) {
+        adjustCalcRefreshRateDivider(targetDivider);
+        refreshRateLowered = true;
+        framesWithCalcHeadroom = 0;
+    } else if(calc_refreshRateDivider > minCalcRefreshRateDivider &&
+        (uint64_t)calcCyclesAverage * 100 <= budgetCyclesPerFrame * (calc_refreshRateDivider - 1) * CALC_THROTTLE_HEADROOM_PERCENT) {
+        // only calculate more often once there's been headroom for a while, so the divider doesn't oscillate
+        if(++framesWithCalcHeadroom >= CALC_THROTTLE_HEADROOM_FRAMES) {
+            adjustCalcRefreshRateDivider(calc_refreshRateDivider - 1);
+            framesWithCalcHeadroom = 0;
+        }
+    } else {
+        framesWithCalcHeadroom = 0;
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -229,6 +357,52 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
     }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNumPanels(void) const {
+    return MATRIX_NUM_PANELS;
+}
+
+// panels that haven't been given a calibration yet are left unchanged
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelCalibration(uint16_t panelIndex, const panelCalibration &calibration) {
+    if(panelIndex >= MATRIX_NUM_PANELS)
+        return;
+
+    if(!panelCalibrationEnabled) {
+        const panelCalibration noCalibration = SM_PANEL_CALIBRATION_NONE;
+        for(int i=0; i<MATRIX_NUM_PANELS; i++)
+            panelCalibrations[i] = noCalibration;
+    }
+
+    panelCalibrations[panelIndex] = calibration;
+    panelCalibrationEnabled = true;
+    panelCalibrationChange = true;
+}
+
+// loads a table of getNumPanels() entries, e.g. one saved to EEPROM or flash
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadPanelCalibration(const panelCalibration * calibrations) {
+    for(int i=0; i<MATRIX_NUM_PANELS; i++)
+        panelCalibrations[i] = calibrations[i];
+
+    panelCalibrationEnabled = true;
+    panelCalibrationChange = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelCalibration(void) {
+    panelCalibrationEnabled = false;
+    panelCalibrationChange = true;
+}
+
+// limits brightness so the estimated current stays under maxLoad/255 of the current drawn with every LED fully on at
+// full brightness, e.g. 127 for a matrix that draws 40A at full white on a 20A supply.  255 disables the limit
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPowerLimit(uint8_t maxLoad) {
+    powerLimitMaxLoad = maxLoad;
+    powerLimitChange = true;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessChange = false;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -264,8 +438,18 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     maxCalcCpuPercentage = newMaxCpuPercentage;
 }
 
+// sets the lowest divider used, the calc throttle can raise the divider from here if calculations take too much CPU time
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcRefreshRateDivider(uint8_t newDivider) {
+    if(newDivider == 0)
+        newDivider = 1;
+
+    minCalcRefreshRateDivider = newDivider;
+    adjustCalcRefreshRateDivider(newDivider);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::adjustCalcRefreshRateDivider(uint8_t newDivider) {
     // TODO: improve so fractional results don't screw up the calc_refreshRate divider
     // TODO: improve to get actual refresh rate from refresh class
     if(newDivider == 0)
@@ -286,6 +470,25 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
     return calc_refreshRate;
 }
 
+// average time spent calculating a frame, measured with the CPU cycle counter
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalculationTimeMicros(void) {
+    return calcCyclesAverage / ESP.getCpuFreqMHz();
+}
+
+// average percentage of CPU time used by calculations at the current calc refresh rate
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalculationCpuPercentage(void) {
+    uint16_t refreshRate = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRate();
+    if(!refreshRate)
+        return 0;
+
+    uint64_t cyclesPerCalc = ((uint64_t)ESP.getCpuFreqMHz() * 1000000UL / refreshRate) * calc_refreshRateDivider;
+    uint64_t percentage = ((uint64_t)calcCyclesAverage * 100) / cyclesPerCalc;
+
+    return (percentage > 100) ? 100 : percentage;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getdmaBufferUnderrunFlag(void) {
     if(dmaBufferUnderrunSinceLastCheck) {
@@ -304,9 +507,27 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     return false;
 }
 
+// bytes of DMA-capable RAM used by the frame buffers and their descriptors, valid after begin()
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getDmaRamUsage(void) {
+    return SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getDmaRamUsage();
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 TaskHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTaskHandle;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerJobStruct SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerJob;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+TaskHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerTaskHandle;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerStartSemaphore;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerDoneSemaphore;
+
 /* Task2 with priority 2 */
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTask(void* pvParameters)
@@ -337,6 +558,27 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     }
 }
 
+// packs the refresh rows loadMatrixBuffers() leaves for the second core, calcTask waits for calcWorkerDoneSemaphore before writing the frame
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcWorkerTask(void* pvParameters)
+{
+    static long lastMillis = 0;
+    while(1) {
+        if( xSemaphoreTake(calcWorkerStartSemaphore, portMAX_DELAY) == pdTRUE ) {
+            long currentMillis = millis();
+            if(currentMillis - lastMillis >= 4500){
+                // sleep a bit to reset the watchdog (default is 5000ms between resets)
+                vTaskDelay(1);
+                lastMillis = currentMillis;
+            }
+
+            loadMatrixBufferRows(1);
+
+            xSemaphoreGive(calcWorkerDoneSemaphore);
+        }
+    }
+}
+
 #define MATRIX_CALC_TASK_DEFAULT_PRIORITY   2
 #define MATRIX_CALC_TASK_LOW_PRIORITY      1
 
@@ -363,8 +605,7 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1)
         calcTaskCore = 1;
 
-    // TODO: fine tune stack size: 1000 works with 64x64/32-24bit, 500 doesn't, does it change based on matrix size, depth?
-    xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", 1000, NULL, taskPriority, &calcTaskHandle, calcTaskCore);
+    xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", ESP32_CALC_TASK_STACK_SIZE, NULL, taskPriority, &calcTaskHandle, calcTaskCore);
 
     printf("SmartMatrix Layers Allocated from Heap:\r\n");
     show_esp32_heap_mem();
@@ -373,18 +614,39 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     // malloc temporary buffers needed for loadMatrixBuffers
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
-    if((COLOR_DEPTH_BITS == 12) || (COLOR_DEPTH_BITS == 16)){
-        tempRow0Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
-        tempRow1Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
-    } else {
-        tempRow0Ptr = malloc(sizeof(rgb24) * numPixelsPerTempRow);
-        tempRow1Ptr = malloc(sizeof(rgb24) * numPixelsPerTempRow);
+    for(int worker=0; worker < ESP32_NUM_CALC_WORKERS; worker++) {
+        if(ESP32_CALC_TEMP_ROWS_RGB48){
+            tempRow0Ptr[worker] = malloc(sizeof(rgb48) * numPixelsPerTempRow);
+            tempRow1Ptr[worker] = malloc(sizeof(rgb48) * numPixelsPerTempRow);
+        } else {
+            tempRow0Ptr[worker] = malloc(sizeof(rgb24) * numPixelsPerTempRow);
+            tempRow1Ptr[worker] = malloc(sizeof(rgb24) * numPixelsPerTempRow);
+        }
+
+        assert(tempRow0Ptr[worker] != NULL);
+        assert(tempRow1Ptr[worker] != NULL);
     }
 
-    assert(tempRow0Ptr != NULL);
-    assert(tempRow1Ptr != NULL);
+    controlWordTemplates = (MATRIX_DATA_STORAGE_TYPE *)malloc(sizeof(MATRIX_DATA_STORAGE_TYPE) * COLOR_DEPTH_BITS * (PIXELS_PER_LATCH + CLKS_DURING_LATCH));
+    assert(controlWordTemplates != NULL);
+
+    refreshBufferPositions = (uint16_t *)malloc(sizeof(uint16_t) * PIXELS_PER_LATCH);
+    assert(refreshBufferPositions != NULL);
 #endif
 
+    buildRowAddressWords();
+    buildColorIndexWords();
+    buildStackedPanelRowSources();
+    buildRefreshBufferPositions();
+
+    if(ESP32_NUM_CALC_WORKERS > 1) {
+        calcWorkerStartSemaphore = xSemaphoreCreateBinary();
+        calcWorkerDoneSemaphore = xSemaphoreCreateBinary();
+
+        // the worker has the same priority and stack needs as calcTask, but runs on the other core
+        xTaskCreatePinnedToCore(calcWorkerTask, "SmartMatrixCalc1", ESP32_CALC_TASK_STACK_SIZE, NULL, taskPriority, &calcWorkerTaskHandle, !calcTaskCore);
+    }
+
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculationsSignal);
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(dmaRamToKeepFreeBytes);
 
@@ -396,103 +658,187 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     while(rotationChange) {
         delay(1);
     }
+
+    printf("SmartMatrixCalc stack unused: %d bytes\r\n", (int)uxTaskGetStackHighWaterMark(calcTaskHandle));
+    if(ESP32_NUM_CALC_WORKERS > 1)
+        printf("SmartMatrixCalc1 stack unused: %d bytes\r\n", (int)uxTaskGetStackHighWaterMark(calcWorkerTaskHandle));
 }
 
-#define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
+#define REFRESH_PRINTFS 0
 
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPosition(void) {   
-    multiRowRefresh_mapIndex_CurrentRowGroups = 0;
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-}
+//#define OEPWM_TEST_ENABLE // this is likely broken now
+#define OEPWM_THRESHOLD_BIT 1
 
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
-    multiRowRefresh_mapIndex_CurrentPixelGroup = multiRowRefresh_mapIndex_CurrentRowGroups;
-    multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
-    multiRowRefresh_NumPanelsAlreadyMapped = 0;
-}
+// I2S Tx FIFO mode1 outputs the samples within each 32-bit word in reverse order, store data pre-swapped to account for it
+#define I2S_BUFFER_POSITION(x) ((MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) ? ((x) ^ 2) : ((x) ^ 1))
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextRow(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildRowAddressWords(void) {
+    for(int row=0; row < MATRIX_SCAN_MOD; row++) {
+        int v = 0;
+        int gpioRowAddress = row;
 
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;
+        if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
+            gpioRowAddress = ~(0x01 << gpioRowAddress);
 
-    // advance until end of table, or entry with new row nubmer is found
-    while(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])) {
-        multiRowRefresh_mapIndex_CurrentRowGroups++;
+#if (CLKS_DURING_LATCH == 0)
+        // if there is no latch to hold address, ADDX lines are output directly to GPIO alongside the RGB data
+        if (gpioRowAddress & 0x01) v|=BIT_A;
+        if (gpioRowAddress & 0x02) v|=BIT_B;
+        if (gpioRowAddress & 0x04) v|=BIT_C;
+        if (gpioRowAddress & 0x08) v|=BIT_D;
+        if (gpioRowAddress & 0x10) v|=BIT_E;
+#else
+        // if external latch is used to hold ADDX lines, ADDX is output on the RGB lines after the pixel data is shifted in
+        if (gpioRowAddress & 0x01) v|=BIT_R1;
+        if (gpioRowAddress & 0x02) v|=BIT_G1;
+        if (gpioRowAddress & 0x04) v|=BIT_B1;
+        if (gpioRowAddress & 0x08) v|=BIT_R2;
+        if (gpioRowAddress & 0x10) v|=BIT_G2;
+        // reserve B2 for OE SWITCH
+#endif
 
-        if(map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset != currentRowOffset)
-            break;
+        rowAddressWords[row] = v;
     }
-
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentPixelGroup].rowOffset;
-
-    // don't change if we're already on the end
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup])) {
-        return;
-    }
-
-    if(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1]) &&
-        // go to the next entry if it's in the same row offset
-        (map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1].rowOffset == currentRowOffset)) {
-        multiRowRefresh_mapIndex_CurrentPixelGroup++;
-    } else {
-        // else we just finished mapping a panel and we're wrapping to the beginning of this row in the list
-        // keep going back until we get to the first entry, or the first entry in this row
-        while((multiRowRefresh_mapIndex_CurrentPixelGroup > 0) && (map[multiRowRefresh_mapIndex_CurrentPixelGroup - 1].rowOffset == currentRowOffset))
-            multiRowRefresh_mapIndex_CurrentPixelGroup--;
-
-        // we need to set the total offset to the beginning offset of the next panel.  Calculate what that would be
-        multiRowRefresh_NumPanelsAlreadyMapped++;
-        multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = multiRowRefresh_NumPanelsAlreadyMapped * COLS_PER_PANEL * PHYSICAL_ROWS_PER_REFRESH_ROW;
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildColorIndexWords(void) {
+    for(int index=0; index < HUB75_COLOR_INDEX_COUNT; index++) {
+        int v = 0;
+
+        // HUB12 format inverts the data (assume we're only using R1 for now)
+        int colorBits = index;
+        if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE)
+            colorBits ^= HUB75_COLOR_INDEX_R0;
+
+        if (colorBits & HUB75_COLOR_INDEX_R0) v|=BIT_R1;
+        if (colorBits & HUB75_COLOR_INDEX_G0) v|=BIT_G1;
+        if (colorBits & HUB75_COLOR_INDEX_B0) v|=BIT_B1;
+        if (colorBits & HUB75_COLOR_INDEX_R1) v|=BIT_R2;
+        if (colorBits & HUB75_COLOR_INDEX_G1) v|=BIT_G2;
+        if (colorBits & HUB75_COLOR_INDEX_B1) v|=BIT_B2;
+
+        colorIndexWords[index] = v;
     }
 }
 
-// returns the row offset from the map, or -1 if we've gone through the whole map already
+// fills stackedPanelRowSources with the rows to load from the layers for each panel in the stack, following the stacking options
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshRowOffset(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])){
-        return -1;
-    }
-
-    return map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;    
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildStackedPanelRowSources(void) {
+    buildHub75StackedPanelRowSources(stackedPanelRowSources, getMultiRowRefreshPanelMap(panelType), MATRIX_SCAN_MOD,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, MATRIX_STACK_HEIGHT, MATRIX_PANEL_HEIGHT, ROW_PAIR_OFFSET,
+        (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING), (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING),
+        hub75StackOrderEsp32);
 }
 
+// fills refreshBufferPositions with the position in the refresh buffer of each temp row pixel, following the panel map
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshNumPixelsToMap(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].numPixels;    
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildRefreshBufferPositions(void) {
+    buildHub75RefreshBufferPositions(refreshBufferPositions, getMultiRowRefreshPanelMap(panelType), PIXELS_PER_LATCH,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, COLS_PER_PANEL);
 }
 
+// fills controlWordTemplates with the OE and LAT bits for each position in each bitplane, which are the same for every row
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshPixelGroupOffset(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildControlWordTemplates(int lsbMsbTransitionBit) {
+    for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+        MATRIX_DATA_STORAGE_TYPE * controlWords = &controlWordTemplates[j * (PIXELS_PER_LATCH + CLKS_DURING_LATCH)];
 
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
-}
+        for(int pos=0; pos < PIXELS_PER_LATCH; pos++) {
+            int v=0;
 
-#define REFRESH_PRINTFS 0
+#if (CLKS_DURING_LATCH == 0)
+            // need to disable OE after latch to hide row transition
+            if(pos == 0) v|=BIT_OE;
 
-//#define OEPWM_TEST_ENABLE // this is likely broken now
-#define OEPWM_THRESHOLD_BIT 1
+            // drive latch while shifting out last bit of RGB data
+            if(pos == PIXELS_PER_LATCH-1) v|=BIT_LAT;
+
+            // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
+            if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
+                if(pos == PIXELS_PER_LATCH-2) v|=BIT_LAT;
+                if(pos == PIXELS_PER_LATCH-3) v|=BIT_LAT;
+            }
+#endif
+
+            // turn off OE after brightness value is reached when displaying MSBs
+            // MSBs always output normal brightness
+            // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
+            if((j > lsbMsbTransitionBit || !j) && (pos >= shiftedBrightness)) v|=BIT_OE;
+
+#ifndef OEPWM_TEST_ENABLE
+            // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+            if(j && j <= lsbMsbTransitionBit) {
+                // divide brightness in half for each bit below lsbMsbTransitionBit
+                int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
+                if(pos >= lsbBrightness) v|=BIT_OE;
+            }
+#else
+            // TODO: this is probably not working after adding support for multi-row refresh panels
+            // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+            if(j && j <= lsbMsbTransitionBit) {
+                // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
+                if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
+                    // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
+                    int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
+                    // now setting brightness for LSB, use PWM OE
+                    if((pos%2) || pos >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
+                } else {
+                    // divide brightness in half for each bit below lsbMsbTransitionBit
+                    int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
+                    if(pos >= lsbBrightness) v|=BIT_OE;
+                }
+            }
+#endif
+
+            // need to turn off OE one clock before latch, otherwise can get ghosting
+#if (CLKS_DURING_LATCH > 0)
+            if(pos == PIXELS_PER_LATCH-1) v|=BIT_OE;
+#else
+            if(pos >= PIXELS_PER_LATCH-2) v|=BIT_OE;
+#endif
+
+            controlWords[pos] = v;
+        }
+
+#if (CLKS_DURING_LATCH > 0)
+        // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data after the pixel data
+        for(int pos=PIXELS_PER_LATCH; pos < PIXELS_PER_LATCH + CLKS_DURING_LATCH; pos++) {
+            int v = 0;
+            // after data is shifted in, pulse latch for one clock cycle
+            if(pos == PIXELS_PER_LATCH) {
+                v|=BIT_LAT;
+            }
+
+            //Do not show image while the line bits are changing
+            v|=BIT_OE;
+
+#ifdef OEPWM_TEST_ENABLE
+            // set the MUX to output PWM_OE instead of DMA_OE, for the latches corresponding to bit 0 - OEPWM_THRESHOLD_BIT
+            if(j < OEPWM_THRESHOLD_BIT) {
+                // now setting brightness for LSB, use PWM OE
+                v|=BIT_B2;
+            }
+#endif
+
+            controlWords[pos] = v;
+        }
+#endif
+
+        if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
+            // HUB12 format inverts the OE signal
+            for(int pos=0; pos < PIXELS_PER_LATCH + CLKS_DURING_LATCH; pos++)
+                controlWords[pos] ^= BIT_OE;
+        }
+    }
+}
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts, int worker) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
+    uint32_t powerLimitSum = 0;
 
 #if (REFRESH_PRINTFS >= 1)
     printf("numPixelsPerTempRow = %d\r\n", numPixelsPerTempRow);
@@ -500,622 +846,339 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 
 #if defined(ESP32)
     // use buffers malloc'd previously
-    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr;
-    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr;
+    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr[worker];
+    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr[worker];
 #else
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[numPixelsPerTempRow];
     static rgb48 tempRow1[numPixelsPerTempRow];
 #endif
 
-    int c = 0;
-    resetMultiRowRefreshMapPosition();
-
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset((void *)tempRow0, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
-        memset((void *)tempRow1, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
-
+    for(int physicalRow=0; physicalRow < PHYSICAL_ROWS_PER_REFRESH_ROW; physicalRow++) {
 #if (REFRESH_PRINTFS >= 1)
-        printf("multiRowRefreshRowOffset = %d\r\n", multiRowRefreshRowOffset);
+        printf("physicalRow = %d\r\n", physicalRow);
 #endif
 
-        // get a row of physical pixel data (HUB75 paired) from the layers
-        SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-        while(templayer) {
+        // get a row of physical pixel data (HUB75 paired) from the layers, loading the rows for each stacked panel calculated in buildStackedPanelRowSources()
+        const StackedPanelRowSource * rowSources = &stackedPanelRowSources[(currentRow * PHYSICAL_ROWS_PER_REFRESH_ROW + physicalRow) * MATRIX_STACK_HEIGHT];
+
+        // a single opaque layer fills each block as it's packed below, the temp rows aren't needed
+        if(!directRefreshLayer) {
+            // the compositor clears the pixels no layer covers
             for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
-                // Z-shape, bottom to top
-                if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // Z-shape, top to bottom
-                } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // C-shape, bottom to top
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // alternate direction of filling (or loading) for each matrixwidth
-                    // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                    if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
-                // C-shape, top to bottom
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    if((MATRIX_STACK_HEIGHT-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
-                }
-            }
-            templayer = templayer->nextLayer;        
-        }
+                SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y0, matrixWidth, &tempRow0[i*matrixWidth], numBrightnessShifts, worker);
+                SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y1, matrixWidth, &tempRow1[i*matrixWidth], numBrightnessShifts, worker);
 
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
-            
-            int i=0;
-
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-
-            while(i < numPixelsPerTempRow) {
-                // get number of pixels to go through with current pass
-                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+                if(panelCalibrationEnabled) {
+                    calibrateHub75Pixels(&tempRow0[i*matrixWidth], matrixWidth, 0, rowSources[i].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                    calibrateHub75Pixels(&tempRow1[i*matrixWidth], matrixWidth, 0, rowSources[i].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                }
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("numPixelsToMap = %d\r\n", numPixelsToMap);
-#endif
+                if(powerLimitMaxLoad < 255)
+                    powerLimitSum += sumHub75Pixels(&tempRow0[i*matrixWidth], matrixWidth) + sumHub75Pixels(&tempRow1[i*matrixWidth], matrixWidth);
 
-                bool reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
+                // spread the bits below COLOR_DEPTH_BITS over neighbouring pixels instead of dropping them
+                if((optionFlags & SMARTMATRIX_OPTIONS_SPATIAL_DITHERING) && COLOR_DEPTH_BITS < 16) {
+                    orderedDitherHub75Row(&tempRow0[i*matrixWidth], matrixWidth, 0, rowSources[i].y0, 0, 16 - COLOR_DEPTH_BITS);
+                    orderedDitherHub75Row(&tempRow1[i*matrixWidth], matrixWidth, 0, rowSources[i].y1, 0, 16 - COLOR_DEPTH_BITS);
                 }
+            }
+        }
 
-                // get offset where pixels are written in the refresh buffer
-                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        // source bits to extract: only the COLOR_DEPTH_BITS MSBs of rgb48 are used, e.g. 12 for 36-bit color
+        int firstBit = 16 - COLOR_DEPTH_BITS;
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("currentMapOffset = %d\r\n", currentMapOffset);
+        // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
+#if (CLKS_DURING_LATCH == 0)
+        MATRIX_DATA_STORAGE_TYPE addressWord = rowAddressWords[currentRow];
+        MATRIX_DATA_STORAGE_TYPE lsbAddressWord = rowAddressWords[(currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD];
+#else
+        // ADDX is loaded into the external latch after the pixel data, nothing to output alongside RGB data
+        MATRIX_DATA_STORAGE_TYPE addressWord = 0;
+        MATRIX_DATA_STORAGE_TYPE lsbAddressWord = 0;
 #endif
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+        // refresh buffer position of each pixel in the temp rows was calculated in buildRefreshBufferPositions()
+        const uint16_t * positions = &refreshBufferPositions[physicalRow * numPixelsPerTempRow];
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
+        // parse through the temp rows in blocks, extracting all bitplanes of a block at once and writing them to the refresh buffer
+        int numBlockPixels;
+        for(i=0; i < numPixelsPerTempRow; i += numBlockPixels) {
+            // blocks don't cross from one stacked panel to the next
+            numBlockPixels = min(HUB75_BITPLANE_BLOCK_PIXELS, numPixelsPerTempRow - i);
+            numBlockPixels = min(numBlockPixels, matrixWidth - (i%matrixWidth));
 
-#if (REFRESH_PRINTFS >= 2)
-                printf("j = %02d, i = %03d, c = %03d, k = %03d, pos = %03d\r\n", j, i, c, k, refreshBufferPosition);
-#endif
+            if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
+                //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
+                //TODO: support C-shape stacking
+                continue;
+            }
 
-#if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
-
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;                        
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
-                    }
-#endif
+            uint8_t (*bitplanes)[HUB75_BITPLANE_BLOCK_PIXELS] = calcWorkerBuffers[worker].bitplanes;
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+            if(directRefreshLayer) {
+                rgb48 * blockRow0 = calcWorkerBuffers[worker].rgb48BlockRow0;
+                rgb48 * blockRow1 = calcWorkerBuffers[worker].rgb48BlockRow1;
 
-#ifndef OEPWM_TEST_ENABLE
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // divide brightness in half for each bit below lsbMsbTransitionBit
-                        int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                        if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                    }
-#else
-                    // TODO: this is probably not working after adding support for multi-row refresh panels
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
-                        if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
-                            // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
-                            int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
-                            // now setting brightness for LSB, use PWM OE
-                            if((k%2) || k >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
-                        } else {
-                            // divide brightness in half for each bit below lsbMsbTransitionBit
-                            int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                            if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                        }
-                    }                
-#endif
-                    
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
-#if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
-#else
-                    if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
-#endif
+                SM_CALC_PROFILE_START(fillStartTicks);
+                directRefreshLayer->fillRefreshPixels(i%matrixWidth, rowSources[i/matrixWidth].y0, numBlockPixels, blockRow0, numBrightnessShifts);
+                directRefreshLayer->fillRefreshPixels(i%matrixWidth, rowSources[i/matrixWidth].y1, numBlockPixels, blockRow1, numBrightnessShifts);
+                SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, directRefreshLayer, worker, SM_CALC_PROFILE_ELAPSED(fillStartTicks));
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
-
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
-
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
-
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
-
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
-                    } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p->data[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p->data[(refreshBufferPosition)-2] = v;
-                            }
-                        } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p->data[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p->data[(refreshBufferPosition)+1] = v;
-                            }
-                        }
-                    }
+                if(panelCalibrationEnabled) {
+                    calibrateHub75Pixels(blockRow0, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                    calibrateHub75Pixels(blockRow1, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
                 }
 
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
-            }
+                if(powerLimitMaxLoad < 255)
+                    powerLimitSum += sumHub75Pixels(blockRow0, numBlockPixels) + sumHub75Pixels(blockRow1, numBlockPixels);
 
-            // TODO: insert latch data for all color depth bits all at once at the end, saving a few cycles?
-            // TODO: prefill latch across all frames during begin() and only need to update when brightness/refreshrate changed?
-#if (CLKS_DURING_LATCH > 0)
-            // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
-            for(int k=PIXELS_PER_LATCH; k < PIXELS_PER_LATCH + CLKS_DURING_LATCH; k++) {
-                int v = 0;
-                // after data is shifted in, pulse latch for one clock cycle
-                if(k == PIXELS_PER_LATCH) {
-                    v|=BIT_LAT;
+                if((optionFlags & SMARTMATRIX_OPTIONS_SPATIAL_DITHERING) && COLOR_DEPTH_BITS < 16) {
+                    orderedDitherHub75Row(blockRow0, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y0, 0, 16 - COLOR_DEPTH_BITS);
+                    orderedDitherHub75Row(blockRow1, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y1, 0, 16 - COLOR_DEPTH_BITS);
                 }
 
-                //Do not show image while the line bits are changing
-                v|=BIT_OE;
+                extractHub75Bitplanes(blockRow0, blockRow1, 1, numBlockPixels, firstBit, COLOR_DEPTH_BITS, bitplanes, calcWorkerBuffers[worker].bitplaneScratch);
+            } else {
+                extractHub75Bitplanes(&tempRow0[i], &tempRow1[i], 1, numBlockPixels, firstBit, COLOR_DEPTH_BITS, bitplanes, calcWorkerBuffers[worker].bitplaneScratch);
+            }
 
-                // set ADDX values to high while latch is high, keep them high while latch drops to clock it in to ADDX latch
-                if(k >= PIXELS_PER_LATCH) {               
-                    int gpioRowAddress = currentRow;
+            for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+                SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
 
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
+                // OE and LAT bits for this bitplane were calculated in buildControlWordTemplates()
+                const MATRIX_DATA_STORAGE_TYPE * controlWords = &controlWordTemplates[j * (PIXELS_PER_LATCH + CLKS_DURING_LATCH)];
+                MATRIX_DATA_STORAGE_TYPE bitplaneAddressWord = j ? addressWord : lsbAddressWord;
 
-                    if (gpioRowAddress & 0x01) v|=BIT_R1;
-                    if (gpioRowAddress & 0x02) v|=BIT_G1;
-                    if (gpioRowAddress & 0x04) v|=BIT_B1;
-                    if (gpioRowAddress & 0x08) v|=BIT_R2;
-                    if (gpioRowAddress & 0x10) v|=BIT_G2;
-                    // reserve B2 for OE SWITCH
-#ifdef OEPWM_TEST_ENABLE
-                    //if(j == 0) {
-                    // set the MUX to output PWM_OE instead of DMA_OE, for the latches corresponding to bit 0 - OEPWM_THRESHOLD_BIT
-                    if(j < OEPWM_THRESHOLD_BIT) {
-                        // now setting brightness for LSB, use PWM OE
-                        v|=BIT_B2;
-                    }
+                for(int b=0; b < numBlockPixels; b++) {
+                    int refreshBufferPosition = positions[i+b];
+
+#if (REFRESH_PRINTFS >= 2)
+                    printf("j = %02d, i = %03d, pos = %03d\r\n", j, i+b, refreshBufferPosition);
 #endif
-                }
 
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    // HUB12 inverts data (irrelevant here) and OE signals
-                    if(v & BIT_OE) {
-                        v = v & ~(BIT_OE);
-                    } else {
-                        v |= BIT_OE;
-                    }
+                    p->data[I2S_BUFFER_POSITION(refreshBufferPosition)] = controlWords[refreshBufferPosition] | bitplaneAddressWord | colorIndexWords[bitplanes[j][b]];
                 }
+            }
+        }
 
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                    //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                    if(k%4 == 0){
-                        p->data[k+2] = v;
-                    } else if(k%4 == 1) {
-                        p->data[k+2] = v;
-                    } else if(k%4 == 2) {
-                        p->data[k-2] = v;
-                    } else { //if(k%4 == 3)
-                        p->data[k-2] = v;
-                    }
-                } else {
-                    //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                    if(k%2){
-                        p->data[k-1] = v;
-                    } else {
-                        p->data[k+1] = v;
-                    }
-                }
+#if (CLKS_DURING_LATCH > 0)
+        // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
+        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]);
+            const MATRIX_DATA_STORAGE_TYPE * controlWords = &controlWordTemplates[j * (PIXELS_PER_LATCH + CLKS_DURING_LATCH)];
+
+            for(int k=PIXELS_PER_LATCH; k < PIXELS_PER_LATCH + CLKS_DURING_LATCH; k++) {
+                p->data[I2S_BUFFER_POSITION(k)] = controlWords[k] | rowAddressWords[currentRow];
             }
-#endif
         }
+#endif
 
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+    }
 
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+    powerLimitRowSums[currentRow] = powerLimitSum;
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers24(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers24(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts, int worker) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
+    uint32_t powerLimitSum = 0;
 
 #if defined(ESP32)
     // use buffers malloc'd previously
-    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr;
-    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr;
+    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr[worker];
+    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr[worker];
 #else
     // static to avoid putting large buffer on the stack
     static rgb24 tempRow0[numPixelsPerTempRow];
     static rgb24 tempRow1[numPixelsPerTempRow];
 #endif
 
-    int c = 0;
-    resetMultiRowRefreshMapPosition();
-
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset((void *)tempRow0, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
-        memset((void *)tempRow1, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+    for(int physicalRow=0; physicalRow < PHYSICAL_ROWS_PER_REFRESH_ROW; physicalRow++) {
+#if (REFRESH_PRINTFS >= 1)
+        printf("physicalRow = %d\r\n", physicalRow);
+#endif
 
-        // get a row of physical pixel data (HUB75 paired) from the layers
-        SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-        while(templayer) {
+        // get a row of physical pixel data (HUB75 paired) from the layers, loading the rows for each stacked panel calculated in buildStackedPanelRowSources()
+        const StackedPanelRowSource * rowSources = &stackedPanelRowSources[(currentRow * PHYSICAL_ROWS_PER_REFRESH_ROW + physicalRow) * MATRIX_STACK_HEIGHT];
+
+        // a single opaque layer fills each block as it's packed below, the temp rows aren't needed
+        if(!directRefreshLayer) {
+            // the compositor clears the pixels no layer covers
             for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
-                // Z-shape, bottom to top
-                if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // Z-shape, top to bottom
-                } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // C-shape, bottom to top
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // alternate direction of filling (or loading) for each matrixwidth
-                    // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                    if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
-                // C-shape, top to bottom
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    if((MATRIX_STACK_HEIGHT-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
+                SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y0, matrixWidth, &tempRow0[i*matrixWidth], numBrightnessShifts, worker);
+                SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y1, matrixWidth, &tempRow1[i*matrixWidth], numBrightnessShifts, worker);
+
+                if(panelCalibrationEnabled) {
+                    calibrateHub75Pixels(&tempRow0[i*matrixWidth], matrixWidth, 0, rowSources[i].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                    calibrateHub75Pixels(&tempRow1[i*matrixWidth], matrixWidth, 0, rowSources[i].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
                 }
+
+                if(powerLimitMaxLoad < 255)
+                    powerLimitSum += sumHub75Pixels(&tempRow0[i*matrixWidth], matrixWidth) + sumHub75Pixels(&tempRow1[i*matrixWidth], matrixWidth);
             }
-            templayer = templayer->nextLayer;        
         }
   
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
-            
-            int i=0;
-
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-
-            while(i < numPixelsPerTempRow) {
-                // get number of pixels to go through with current pass
-                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
-
-                bool reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
+        // source bits to extract: only the 8 MSBs of rgb48 are used for 36-bit color
+        int firstBit = 0;
+        if(COLOR_DEPTH_BITS == 12)   // 36-bit color
+            firstBit = 4;
 
-                // get offset where pixels are written in the refresh buffer
-                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
+#if (CLKS_DURING_LATCH == 0)
+        MATRIX_DATA_STORAGE_TYPE addressWord = rowAddressWords[currentRow];
+        MATRIX_DATA_STORAGE_TYPE lsbAddressWord = rowAddressWords[(currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD];
+#else
+        // ADDX is loaded into the external latch after the pixel data, nothing to output alongside RGB data
+        MATRIX_DATA_STORAGE_TYPE addressWord = 0;
+        MATRIX_DATA_STORAGE_TYPE lsbAddressWord = 0;
+#endif
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+        // refresh buffer position of each pixel in the temp rows was calculated in buildRefreshBufferPositions()
+        const uint16_t * positions = &refreshBufferPositions[physicalRow * numPixelsPerTempRow];
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
+        // parse through the temp rows in blocks, extracting all bitplanes of a block at once and writing them to the refresh buffer
+        int numBlockPixels;
+        for(i=0; i < numPixelsPerTempRow; i += numBlockPixels) {
+            // blocks don't cross from one stacked panel to the next
+            numBlockPixels = min(HUB75_BITPLANE_BLOCK_PIXELS, numPixelsPerTempRow - i);
+            numBlockPixels = min(numBlockPixels, matrixWidth - (i%matrixWidth));
 
-#if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
-
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;                        
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
-                    }
-#endif
+            if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
+                //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
+                //TODO: support C-shape stacking
+                continue;
+            }
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+            uint8_t (*bitplanes)[HUB75_BITPLANE_BLOCK_PIXELS] = calcWorkerBuffers[worker].bitplanes;
 
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // divide brightness in half for each bit below lsbMsbTransitionBit
-                        int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                        if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                    }
+            if(directRefreshLayer) {
+                rgb24 * blockRow0 = calcWorkerBuffers[worker].rgb24BlockRow0;
+                rgb24 * blockRow1 = calcWorkerBuffers[worker].rgb24BlockRow1;
 
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
-#if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
-#else
-                    if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
-#endif
+                SM_CALC_PROFILE_START(fillStartTicks);
+                directRefreshLayer->fillRefreshPixels(i%matrixWidth, rowSources[i/matrixWidth].y0, numBlockPixels, blockRow0, numBrightnessShifts);
+                directRefreshLayer->fillRefreshPixels(i%matrixWidth, rowSources[i/matrixWidth].y1, numBlockPixels, blockRow1, numBrightnessShifts);
+                SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, directRefreshLayer, worker, SM_CALC_PROFILE_ELAPSED(fillStartTicks));
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
-
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
-
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
-
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
-
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
-                    } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p->data[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p->data[(refreshBufferPosition)-2] = v;
-                            }
-                        } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p->data[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p->data[(refreshBufferPosition)+1] = v;
-                            }
-                        }
-                    }
+                if(panelCalibrationEnabled) {
+                    calibrateHub75Pixels(blockRow0, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                    calibrateHub75Pixels(blockRow1, numBlockPixels, i%matrixWidth, rowSources[i/matrixWidth].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
                 }
 
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
+                if(powerLimitMaxLoad < 255)
+                    powerLimitSum += sumHub75Pixels(blockRow0, numBlockPixels) + sumHub75Pixels(blockRow1, numBlockPixels);
+
+                extractHub75Bitplanes(blockRow0, blockRow1, 1, numBlockPixels, firstBit, COLOR_DEPTH_BITS, bitplanes, calcWorkerBuffers[worker].bitplaneScratch);
+            } else {
+                extractHub75Bitplanes(&tempRow0[i], &tempRow1[i], 1, numBlockPixels, firstBit, COLOR_DEPTH_BITS, bitplanes, calcWorkerBuffers[worker].bitplaneScratch);
             }
 
-#if (CLKS_DURING_LATCH > 0)
-            // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
-            for(int k=PIXELS_PER_LATCH; k < PIXELS_PER_LATCH + CLKS_DURING_LATCH; k++) {
-                int v = 0;
-                // after data is shifted in, pulse latch for one clock cycle
-                if(k == PIXELS_PER_LATCH) {
-                    v|=BIT_LAT;
-                }
+            for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+                SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
 
-                //Do not show image while the line bits are changing
-                v|=BIT_OE;
+                // OE and LAT bits for this bitplane were calculated in buildControlWordTemplates()
+                const MATRIX_DATA_STORAGE_TYPE * controlWords = &controlWordTemplates[j * (PIXELS_PER_LATCH + CLKS_DURING_LATCH)];
+                MATRIX_DATA_STORAGE_TYPE bitplaneAddressWord = j ? addressWord : lsbAddressWord;
 
-                // set ADDX values to high while latch is high, keep them high while latch drops to clock it in to ADDX latch
-                if(k >= PIXELS_PER_LATCH) {               
-                    int gpioRowAddress = currentRow;
+                for(int b=0; b < numBlockPixels; b++) {
+                    int refreshBufferPosition = positions[i+b];
 
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
+#if (REFRESH_PRINTFS >= 2)
+                    printf("j = %02d, i = %03d, pos = %03d\r\n", j, i+b, refreshBufferPosition);
+#endif
 
-                    if (gpioRowAddress & 0x01) v|=BIT_R1;
-                    if (gpioRowAddress & 0x02) v|=BIT_G1;
-                    if (gpioRowAddress & 0x04) v|=BIT_B1;
-                    if (gpioRowAddress & 0x08) v|=BIT_R2;
-                    if (gpioRowAddress & 0x10) v|=BIT_G2;
+                    p->data[I2S_BUFFER_POSITION(refreshBufferPosition)] = controlWords[refreshBufferPosition] | bitplaneAddressWord | colorIndexWords[bitplanes[j][b]];
                 }
+            }
+        }
 
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    // HUB12 inverts data (irrelevant here) and OE signals
-                    if(v & BIT_OE) {
-                        v = v & ~(BIT_OE);
-                    } else {
-                        v |= BIT_OE;
-                    }
-                }
+#if (CLKS_DURING_LATCH > 0)
+        // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
+        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]);
+            const MATRIX_DATA_STORAGE_TYPE * controlWords = &controlWordTemplates[j * (PIXELS_PER_LATCH + CLKS_DURING_LATCH)];
 
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                    //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                    if(k%4 == 0){
-                        p->data[k+2] = v;
-                    } else if(k%4 == 1) {
-                        p->data[k+2] = v;
-                    } else if(k%4 == 2) {
-                        p->data[k-2] = v;
-                    } else { //if(k%4 == 3)
-                        p->data[k-2] = v;
-                    }
-                } else {
-                    //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                    if(k%2){
-                        p->data[k-1] = v;
-                    } else {
-                        p->data[k+1] = v;
-                    }
-                }
+            for(int k=PIXELS_PER_LATCH; k < PIXELS_PER_LATCH + CLKS_DURING_LATCH; k++) {
+                p->data[I2S_BUFFER_POSITION(k)] = controlWords[k] | rowAddressWords[currentRow];
             }
-#endif
         }
+#endif
 
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+    }
 
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+    powerLimitRowSums[currentRow] = powerLimitSum;
 }
 
+// returns true if any layer reports a change in one of the rows loaded into refresh row currentRow
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts) {
-#if 1
-    unsigned char currentRow;
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isRefreshRowChanged(int currentRow) {
+    const StackedPanelRowSource * rowSources = &stackedPanelRowSources[currentRow * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
+
+    SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+    while(templayer) {
+        for(int i=0; i<PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT; i++) {
+            if(templayer->isLayerRowChanged(rowSources[i].y0) || templayer->isLayerRowChanged(rowSources[i].y1))
+                return true;
+        }
+        templayer = templayer->nextLayer;
+    }
+
+    return false;
+}
 
-    frameStruct * currentFrameDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr();
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBufferRows(int worker) {
+    frameStruct * currentFrameDataPtr = calcWorkerJob.currentFrameDataPtr;
+    frameStruct * previousFrameDataPtr = calcWorkerJob.previousFrameDataPtr;
+
+    SM_CALC_PROFILE_START(packStartTicks);
+
+    // workers take interleaved refresh rows so the split stays even when only some rows changed
+    for(int currentRow = worker; currentRow < MATRIX_SCAN_MOD; currentRow += ESP32_NUM_CALC_WORKERS) {
+        // the previous frame already has the data for refresh rows that no layer changed
+        if(!calcWorkerJob.allRowsChanged && !isRefreshRowChanged(currentRow)) {
+            memcpy((void *)&currentFrameDataPtr->rowdata[currentRow], (void *)&previousFrameDataPtr->rowdata[currentRow], sizeof(rowDataStruct));
+            continue;
+        }
 
-    for(currentRow = 0; currentRow < MATRIX_SCAN_MOD; currentRow++) {
         // TODO: support rgb36/48 with same function, copy function to rgb24
         if(COLOR_DEPTH_BITS == 16)
-            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, calcWorkerJob.lsbMsbTransitionBit, calcWorkerJob.numBrightnessShifts, worker);
         else if(COLOR_DEPTH_BITS == 12)
-            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, calcWorkerJob.lsbMsbTransitionBit, calcWorkerJob.numBrightnessShifts, worker);
+        else if(COLOR_DEPTH_BITS == 8 && ESP32_CALC_TEMP_ROWS_RGB48)
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, calcWorkerJob.lsbMsbTransitionBit, calcWorkerJob.numBrightnessShifts, worker);
         else if(COLOR_DEPTH_BITS == 8)
-            loadMatrixBuffers24(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers24(currentFrameDataPtr, currentRow, calcWorkerJob.lsbMsbTransitionBit, calcWorkerJob.numBrightnessShifts, worker);
     }
-#endif
+
+    SM_CALC_PROFILE_ADD(calcStageBitplanePacking, NULL, worker, SM_CALC_PROFILE_ELAPSED(packStartTicks));
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts, bool allRowsChanged) {
+    calcWorkerJob.currentFrameDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr();
+    calcWorkerJob.previousFrameDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPreviousFrameBufferPtr();
+    calcWorkerJob.lsbMsbTransitionBit = lsbMsbTransitionBit;
+    calcWorkerJob.numBrightnessShifts = numBrightnessShifts;
+    calcWorkerJob.allRowsChanged = allRowsChanged;
+
+    // a single opaque layer can fill blocks of pixels as they're packed, without staging them in the temp rows
+    if(baseLayer && !baseLayer->nextLayer && baseLayer->hasRefreshPixels())
+        directRefreshLayer = baseLayer;
+    else
+        directRefreshLayer = NULL;
+
+    if(ESP32_NUM_CALC_WORKERS > 1)
+        xSemaphoreGive(calcWorkerStartSemaphore);
+
+    loadMatrixBufferRows(0);
+
+    // the frame can't be written until the worker on the other core is done with its rows
+    if(ESP32_NUM_CALC_WORKERS > 1)
+        xSemaphoreTake(calcWorkerDoneSemaphore, portMAX_DELAY);
 }
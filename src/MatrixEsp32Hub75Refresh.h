@@ -26,7 +26,15 @@
 
 #include "esp32_i2s_parallel.h"
 
+// frame buffers each get their own DMA descriptor chain, define as 3 or more before including SmartMatrix.h to let the calc task
+// start a new frame without overwriting the one still being refreshed, at the cost of more DMA RAM (see getDmaRamUsage())
+#ifndef ESP32_NUM_FRAME_BUFFERS
 #define ESP32_NUM_FRAME_BUFFERS   2
+#endif
+
+#if (ESP32_NUM_FRAME_BUFFERS < 2)
+#error "ESP32_NUM_FRAME_BUFFERS must be 2 or more"
+#endif
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixHub75Refresh {
@@ -51,6 +59,7 @@ public:
 
     // refresh API
     static frameStruct * getNextFrameBufferPtr(void);
+    static frameStruct * getPreviousFrameBufferPtr(void);
     static void writeFrameBuffer(uint8_t currentFrame);
     static void recoverFromDmaUnderrun(void);
     static bool isFrameBufferFree(void);
@@ -60,12 +69,14 @@ public:
     static void setMatrixCalculationsCallback(matrix_calc_callback f);
     static void markRefreshComplete(void);
     static uint8_t getLsbMsbTransitionBit(void);
+    static uint32_t getDmaRamUsage(void);
 
 private:
     static uint16_t refreshRate;
     static uint16_t minRefreshRate;
     static uint8_t lsbMsbTransitionBit;
     static frameStruct * matrixUpdateFrames[ESP32_NUM_FRAME_BUFFERS];
+    static uint32_t dmaRamUsage;
 
     static matrix_calc_callback matrixCalcCallback;
 
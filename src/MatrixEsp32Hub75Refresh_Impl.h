@@ -65,13 +65,17 @@ uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelTy
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrames[ESP32_NUM_FRAME_BUFFERS];
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaRamUsage = 0;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Refresh(void) {
 }
 
+// one buffer is always being refreshed and isn't in dmaBuffer, so the frames waiting to be refreshed can't fill all of dmaBuffer
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameBufferFree(void) {
-    if(cbIsFull(&dmaBuffer))
+    if(dmaBuffer.count >= ESP32_NUM_FRAME_BUFFERS - 1)
         return false;
     else
         return true;
@@ -82,6 +86,12 @@ typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelT
     return matrixUpdateFrames[cbGetNextWrite(&dmaBuffer)];
 }
 
+// returns the frame buffer most recently passed to writeFrameBuffer()
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPreviousFrameBufferPtr(void) {
+    return matrixUpdateFrames[(cbGetNextWrite(&dmaBuffer) + ESP32_NUM_FRAME_BUFFERS - 1) % ESP32_NUM_FRAME_BUFFERS];
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(uint8_t currentFrame) {
     //SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * currentFramePtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr();
@@ -127,16 +137,14 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
     printf("Starting SmartMatrix DMA Mallocs\r\n");
 
     // TODO: malloc this buffer before other smaller buffers as this is (by far) the largest buffer to allocate?
-    matrixUpdateFrames[0] = (frameStruct *)heap_caps_malloc(sizeof(frameStruct), MALLOC_CAP_DMA);
-    assert(matrixUpdateFrames[0] != NULL);
-    matrixUpdateFrames[1] = (frameStruct *)heap_caps_malloc(sizeof(frameStruct), MALLOC_CAP_DMA);
-    assert(matrixUpdateFrames[1] != NULL);
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++) {
+        matrixUpdateFrames[i] = (frameStruct *)heap_caps_malloc(sizeof(frameStruct), MALLOC_CAP_DMA);
+        assert(matrixUpdateFrames[i] != NULL);
+    }
 
     printf("sizeof framestruct: %08X\r\n", (uint32_t)sizeof(frameStruct));
-    show_esp32_dma_mem("DMA Memory Available before ptr1 alloc");
-    printf("matrixUpdateFrames[0] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[0]);
-    show_esp32_dma_mem("DMA Memory Available before ptr2 alloc");
-    printf("matrixUpdateFrames[1] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[1]);
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++)
+        printf("matrixUpdateFrames[%d] pointer: %08X\r\n", i, (uint32_t)matrixUpdateFrames[i]);
 
     printf("Frame Structs Allocated from Heap:\r\n");
     show_esp32_all_mem();
@@ -232,36 +240,37 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
         numDescriptorsPerRow += 1<<(i - lsbMsbTransitionBit - 1);
     }
 
-    printf("Descriptors for lsbMsbTransitionBit %d/%d with %d rows require %d bytes of DMA RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, MATRIX_SCAN_MOD, 2 * numDescriptorsPerRow * MATRIX_SCAN_MOD * sizeof(lldesc_t));
+    printf("Descriptors for lsbMsbTransitionBit %d/%d with %d rows require %d bytes of DMA RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, MATRIX_SCAN_MOD, ESP32_NUM_FRAME_BUFFERS * numDescriptorsPerRow * MATRIX_SCAN_MOD * sizeof(lldesc_t));
 
-    // malloc the DMA linked list descriptors that i2s_parallel will need
+    // malloc the DMA linked list descriptors that i2s_parallel will need, one chain per frame buffer
     int desccount = numDescriptorsPerRow * MATRIX_SCAN_MOD;
-    lldesc_t * dmadesc_a = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    if(!dmadesc_a) {
-        printf("can't malloc dmadesc_a");
-        return;
-    }
-    lldesc_t * dmadesc_b = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    if(!dmadesc_b) {
-        printf("can't malloc dmadesc_b");
-        return;
+    // static as i2s_parallel keeps a pointer to the chains past the first two
+    static lldesc_t * dmadesc[ESP32_NUM_FRAME_BUFFERS];
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++) {
+        dmadesc[i] = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
+        if(!dmadesc[i]) {
+            printf("can't malloc dmadesc[%d]", i);
+            return;
+        }
     }
 
+    dmaRamUsage = ESP32_NUM_FRAME_BUFFERS * (sizeof(frameStruct) + desccount * sizeof(lldesc_t));
+    printf("%d frame buffers and descriptors use %d bytes of DMA RAM\r\n", ESP32_NUM_FRAME_BUFFERS, dmaRamUsage);
+
     printf("SmartMatrix Mallocs Complete\r\n");
     show_esp32_all_mem();
 
-    lldesc_t *prevdmadesca = 0;
-    lldesc_t *prevdmadescb = 0;
+    lldesc_t *prevdmadesc[ESP32_NUM_FRAME_BUFFERS] = {0};
     int currentDescOffset = 0;
 
-    // fill DMA linked lists for both frames
+    // fill DMA linked lists for all frames
     for(int j=0; j<MATRIX_SCAN_MOD; j++) {
         // first set of data is LSB through MSB, single pass - all color bits are displayed once, which takes care of everything below and inlcluding LSBMSB_TRANSITION_BIT
         // TODO: size must be less than DMA_MAX - worst case for SmartMatrix Library: 16-bpp with 256 pixels per row would exceed this, need to break into two
-        link_dma_desc(&dmadesc_a[currentDescOffset], prevdmadesca, matrixUpdateFrames[0]->rowdata[j].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
-        prevdmadesca = &dmadesc_a[currentDescOffset];
-        link_dma_desc(&dmadesc_b[currentDescOffset], prevdmadescb, matrixUpdateFrames[1]->rowdata[j].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
-        prevdmadescb = &dmadesc_b[currentDescOffset];
+        for(int f=0; f<ESP32_NUM_FRAME_BUFFERS; f++) {
+            link_dma_desc(&dmadesc[f][currentDescOffset], prevdmadesc[f], matrixUpdateFrames[f]->rowdata[j].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
+            prevdmadesc[f] = &dmadesc[f][currentDescOffset];
+        }
         currentDescOffset++;
         //printf("row %d: \r\n", j);
 
@@ -271,10 +280,10 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
             // we need 2^(i - LSBMSB_TRANSITION_BIT - 1) == 1 << (i - LSBMSB_TRANSITION_BIT - 1) passes from i to MSB
             //printf("buffer %d: repeat %d times, size: %d, from %d - %d\r\n", nextBufdescIndex, 1<<(i - LSBMSB_TRANSITION_BIT - 1), (COLOR_DEPTH_BITS - i), i, COLOR_DEPTH_BITS-1);
             for(int k=0; k < 1<<(i - lsbMsbTransitionBit - 1); k++) {
-                link_dma_desc(&dmadesc_a[currentDescOffset], prevdmadesca, matrixUpdateFrames[0]->rowdata[j].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
-                prevdmadesca = &dmadesc_a[currentDescOffset];
-                link_dma_desc(&dmadesc_b[currentDescOffset], prevdmadescb, matrixUpdateFrames[1]->rowdata[j].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
-                prevdmadescb = &dmadesc_b[currentDescOffset];
+                for(int f=0; f<ESP32_NUM_FRAME_BUFFERS; f++) {
+                    link_dma_desc(&dmadesc[f][currentDescOffset], prevdmadesc[f], matrixUpdateFrames[f]->rowdata[j].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
+                    prevdmadesc[f] = &dmadesc[f][currentDescOffset];
+                }
 
                 currentDescOffset++;
                 //printf("i %d, j %d, k %d\r\n", i, j, k);
@@ -283,10 +292,10 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
     }
 
     //End markers
-    dmadesc_a[desccount-1].eof = 1;
-    dmadesc_b[desccount-1].eof = 1;
-    dmadesc_a[desccount-1].qe.stqe_next=(lldesc_t*)&dmadesc_a[0];
-    dmadesc_b[desccount-1].qe.stqe_next=(lldesc_t*)&dmadesc_b[0];
+    for(int f=0; f<ESP32_NUM_FRAME_BUFFERS; f++) {
+        dmadesc[f][desccount-1].eof = 1;
+        dmadesc[f][desccount-1].qe.stqe_next=(lldesc_t*)&dmadesc[f][0];
+    }
 
     //printf("\n");
 
@@ -456,8 +465,10 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
         .bufb=0,
         desccount,
         desccount,
-        dmadesc_a,
-        dmadesc_b
+        dmadesc[0],
+        dmadesc[1],
+        &dmadesc[2],
+        ESP32_NUM_FRAME_BUFFERS - 2
     };
 
     //Setup I2S
@@ -466,9 +477,11 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
     //printf("I2S setup done.\n");
 }
 
+// the DMA chains all point to the last buffer passed to writeFrameBuffer(), so at the end of a refresh it's the one being refreshed,
+// and any frame written before it was skipped: release them all, keeping the latest frame
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markRefreshComplete(void) {
-    if(!cbIsEmpty(&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer))
+    while(!cbIsEmpty(&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer))
         cbRead(&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
 }
 
@@ -476,3 +489,8 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getLsbMsbTransitionBit(void) {
     return lsbMsbTransitionBit;
 }
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getDmaRamUsage(void) {
+    return dmaRamUsage;
+}
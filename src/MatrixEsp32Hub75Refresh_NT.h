@@ -26,7 +26,7 @@
 
 #include "esp32_i2s_parallel.h"
 
-#define ESP32_NUM_FRAME_BUFFERS   2
+#define ESP32_NT_NUM_FRAME_BUFFERS   2
 
 // note "SIZE_OF" refers to size in bytes, equivilent to sizeof(rowbitStruct), etc
 #define SIZE_OF_ROWBITSTRUCT ((PIXELS_PER_LATCH + CLKS_DURING_LATCH) * sizeof(MATRIX_DATA_STORAGE_TYPE))
@@ -67,7 +67,7 @@ private:
     uint16_t refreshRate;
     uint16_t minRefreshRate;
     uint8_t lsbMsbTransitionBit;
-    MATRIX_DATA_STORAGE_TYPE * matrixUpdateFrames[ESP32_NUM_FRAME_BUFFERS];
+    MATRIX_DATA_STORAGE_TYPE * matrixUpdateFrames[ESP32_NT_NUM_FRAME_BUFFERS];
 
     matrix_calc_callback matrixCalcCallback;
 
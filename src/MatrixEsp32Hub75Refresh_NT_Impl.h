@@ -100,7 +100,7 @@ uint16_t SmartMatrixHub75Refresh_NT<dummyvar>::getRefreshRate(void) {
 
 template <int dummyvar>
 void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes) {
-    cbInit(&dmaBuffer, ESP32_NUM_FRAME_BUFFERS);
+    cbInit(&dmaBuffer, ESP32_NT_NUM_FRAME_BUFFERS);
 
     printf("Starting SmartMatrix DMA Mallocs\r\n");
 
@@ -147,7 +147,7 @@ void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
             numDescriptorsPerRow += 1<<(i - lsbMsbTransitionBit - 1);
         }
 
-        int ramrequired = numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NUM_FRAME_BUFFERS * sizeof(lldesc_t);
+        int ramrequired = numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NT_NUM_FRAME_BUFFERS * sizeof(lldesc_t);
         int largestblockfree = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
 
         printf("lsbMsbTransitionBit of %d requires %d RAM, %d available, leaving %d free: \r\n", lsbMsbTransitionBit, ramrequired, largestblockfree, largestblockfree - ramrequired);
@@ -161,7 +161,7 @@ void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
             break;
     }
 
-    if(numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NUM_FRAME_BUFFERS * sizeof(lldesc_t) > heap_caps_get_largest_free_block(MALLOC_CAP_DMA)){
+    if(numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NT_NUM_FRAME_BUFFERS * sizeof(lldesc_t) > heap_caps_get_largest_free_block(MALLOC_CAP_DMA)){
         printf("not enough RAM for SmartMatrix descriptors\r\n");
         return;
     }
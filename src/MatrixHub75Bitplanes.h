@@ -0,0 +1,258 @@
+/*
+ * SmartMatrix Library - Bitplane Extraction for HUB75 Refresh Buffers
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MatrixHub75Bitplanes_h
+#define MatrixHub75Bitplanes_h
+
+#include <stdint.h>
+
+/*  Instead of testing the six color channels of a pixel once per bitplane, blocks of up to 8 pixels are
+    converted with bit-matrix transposes: each channel is transposed so one byte holds a single bit of the
+    channel for all 8 pixels, then the six channel bytes for each bitplane are transposed back so each pixel
+    gets a 6-bit color index.  The calc classes map the index to the pin word with a 64-entry lookup table. */
+
+#define HUB75_BITPLANE_BLOCK_PIXELS     8
+
+// bits in the color index produced by extractHub75Bitplanes()
+#define HUB75_COLOR_INDEX_R0            (1 << 0)
+#define HUB75_COLOR_INDEX_G0            (1 << 1)
+#define HUB75_COLOR_INDEX_B0            (1 << 2)
+#define HUB75_COLOR_INDEX_R1            (1 << 3)
+#define HUB75_COLOR_INDEX_G1            (1 << 4)
+#define HUB75_COLOR_INDEX_B1            (1 << 5)
+#define HUB75_COLOR_INDEX_COUNT         (1 << 6)
+
+// transpose an 8x8 bit matrix held in two words: row n is byte n (rows 0-3 in lo, rows 4-7 in hi), column n is bit n of each byte
+static inline void transposeHub75Bits8x8(uint32_t &lo, uint32_t &hi) {
+    uint32_t t;
+
+    // swap 1x1 blocks, then 2x2 blocks within each word
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA;  lo ^= t ^ (t << 7);
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA;  hi ^= t ^ (t << 7);
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo ^= t ^ (t << 14);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi ^= t ^ (t << 14);
+
+    // swap 4x4 blocks between the two words
+    t = (lo ^ (hi << 4)) & 0xF0F0F0F0;
+    lo ^= t;
+    hi ^= t >> 4;
+}
+
+// transposes the byte selected by byteShift of 8 channel values, storing bit n of all 8 values in planes[n]
+static inline void transposeHub75Channel(const uint16_t values[HUB75_BITPLANE_BLOCK_PIXELS], int byteShift, uint8_t planes[8]) {
+    uint32_t lo = 0, hi = 0;
+
+    for(int p=0; p<4; p++) {
+        lo |= (uint32_t)((values[p] >> byteShift) & 0xFF) << (p * 8);
+        hi |= (uint32_t)((values[p + 4] >> byteShift) & 0xFF) << (p * 8);
+    }
+
+    transposeHub75Bits8x8(lo, hi);
+
+    for(int n=0; n<4; n++) {
+        planes[n] = lo >> (n * 8);
+        planes[n + 4] = hi >> (n * 8);
+    }
+}
+
+// working space for extractHub75Bitplanes(), callers running on small task stacks keep one per task
+typedef struct hub75BitplaneScratch {
+    uint16_t    channels[6][HUB75_BITPLANE_BLOCK_PIXELS];
+    // channelPlanes[c][n] holds bit n of channel c for all pixels
+    uint8_t     channelPlanes[6][16];
+} hub75BitplaneScratch;
+
+/*  Extract bits firstBit through (firstBit + numBits - 1) of numPixels (up to 8) pixel pairs, reading row0/row1 at
+    multiples of step (use -1 to read a reversed block).  bitplanes[n][p] is set to the HUB75_COLOR_INDEX_* bits of
+    pixel p for bit (firstBit + n), pixels past numPixels are treated as black. */
+template <typename RGB_TEMP>
+static inline void extractHub75Bitplanes(const RGB_TEMP * row0, const RGB_TEMP * row1, int step, int numPixels,
+    int firstBit, int numBits, uint8_t bitplanes[][HUB75_BITPLANE_BLOCK_PIXELS], hub75BitplaneScratch &scratch) {
+
+    uint16_t (*channels)[HUB75_BITPLANE_BLOCK_PIXELS] = scratch.channels;
+
+    for(int p=0; p<HUB75_BITPLANE_BLOCK_PIXELS; p++) {
+        if(p < numPixels) {
+            channels[0][p] = row0[p * step].red;
+            channels[1][p] = row0[p * step].green;
+            channels[2][p] = row0[p * step].blue;
+            channels[3][p] = row1[p * step].red;
+            channels[4][p] = row1[p * step].green;
+            channels[5][p] = row1[p * step].blue;
+        } else {
+            for(int c=0; c<6; c++)
+                channels[c][p] = 0;
+        }
+    }
+
+    // only transpose the bytes that contain requested bits
+    uint8_t (*channelPlanes)[16] = scratch.channelPlanes;
+
+    for(int c=0; c<6; c++) {
+        if(firstBit < 8)
+            transposeHub75Channel(channels[c], 0, &channelPlanes[c][0]);
+        if(firstBit + numBits > 8)
+            transposeHub75Channel(channels[c], 8, &channelPlanes[c][8]);
+    }
+
+    // transpose the six channel bytes of each bitplane back into one color index per pixel
+    for(int n=0; n<numBits; n++) {
+        int bit = firstBit + n;
+        uint32_t lo = channelPlanes[0][bit] | (channelPlanes[1][bit] << 8) | (channelPlanes[2][bit] << 16) | ((uint32_t)channelPlanes[3][bit] << 24);
+        uint32_t hi = channelPlanes[4][bit] | (channelPlanes[5][bit] << 8);
+
+        transposeHub75Bits8x8(lo, hi);
+
+        for(int p=0; p<4; p++) {
+            bitplanes[n][p] = lo >> (p * 8);
+            bitplanes[n][p + 4] = hi >> (p * 8);
+        }
+    }
+}
+
+template <typename RGB_TEMP>
+static inline void extractHub75Bitplanes(const RGB_TEMP * row0, const RGB_TEMP * row1, int step, int numPixels,
+    int firstBit, int numBits, uint8_t bitplanes[][HUB75_BITPLANE_BLOCK_PIXELS]) {
+    hub75BitplaneScratch scratch;
+
+    extractHub75Bitplanes(row0, row1, step, numPixels, firstBit, numBits, bitplanes, scratch);
+}
+
+// 4x4 Bayer matrix, the order orderedDitherHub75Row() rounds neighbouring pixels up in
+static const uint8_t hub75DitherThresholds[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+/*  Ordered dithering: before the low numDitherBits bits of each channel are dropped, adds the Bayer matrix threshold for
+    each pixel's position, offset by thresholdOffset (mod 16) and scaled to the dropped bits.  The truncation error is spread
+    over neighbouring pixels instead of showing up as banding in gradients.  x and y are the hardware position of row[0] */
+template <typename RGB_TEMP>
+static inline void orderedDitherHub75Row(RGB_TEMP * row, int numPixels, int x, int y, uint8_t thresholdOffset, int numDitherBits) {
+    const uint32_t maxValue = (sizeof(RGB_TEMP) <= 3) ? 0xFF : 0xFFFF;
+    uint32_t dither[4];
+
+    for(int i=0; i<4; i++) {
+        uint32_t threshold = (hub75DitherThresholds[y & 3][(x + i) & 3] + thresholdOffset) & 0x0F;
+        dither[i] = (numDitherBits >= 4) ? (threshold << (numDitherBits - 4)) : (threshold >> (4 - numDitherBits));
+    }
+
+    for(int i=0; i<numPixels; i++) {
+        uint32_t red = row[i].red + dither[i & 3];
+        uint32_t green = row[i].green + dither[i & 3];
+        uint32_t blue = row[i].blue + dither[i & 3];
+
+        row[i].red = (red > maxValue) ? maxValue : red;
+        row[i].green = (green > maxValue) ? maxValue : green;
+        row[i].blue = (blue > maxValue) ? maxValue : blue;
+    }
+}
+
+/*  Temporal dithering (frame rate control): the ordered dithering thresholds cycle through 16 levels over 16 frames, so each
+    pixel is rounded up in the fraction of frames matching the dropped bits and the average over time keeps about 4 more
+    bits than are refreshed.  y is the hardware row, and frameCount advances once per frame */
+template <typename RGB_TEMP>
+static inline void temporalDitherHub75Row(RGB_TEMP * row, int numPixels, int y, uint8_t frameCount, int numDitherBits) {
+    // 7 is odd, so each pixel steps through all 16 thresholds
+    orderedDitherHub75Row(row, numPixels, 0, y, frameCount * 7, numDitherBits);
+}
+
+static inline uint32_t calibrateHub75Channel(uint32_t value, uint32_t gain, int32_t offset, int32_t maxValue) {
+    if(!value)
+        return 0;
+
+    int32_t calibrated = (int32_t)((value * gain) >> 8) + offset;
+    return (calibrated < 0) ? 0 : ((calibrated > maxValue) ? maxValue : calibrated);
+}
+
+/*  Per-panel calibration: scales numPixels pixels of hardware row y, starting at hardware column x, by the gains of the
+    panel each pixel is on, then adds the panel's offset to the channels that aren't off.  calibrations has one entry per
+    panel, panelsPerRow panels of panelWidth x panelHeight pixels to a row.  Pixels are handled in runs that stay on one
+    panel, and panels left at SM_PANEL_CALIBRATION_NONE are skipped */
+template <typename RGB_TEMP>
+static inline void calibrateHub75Pixels(RGB_TEMP * pixels, int numPixels, int x, int y, const panelCalibration * calibrations,
+    int panelWidth, int panelHeight, int panelsPerRow) {
+    const int32_t maxValue = (sizeof(RGB_TEMP) <= 3) ? 0xFF : 0xFFFF;
+    const int32_t offsetScale = (sizeof(RGB_TEMP) <= 3) ? 1 : 256;
+
+    const panelCalibration * rowCalibrations = &calibrations[(y / panelHeight) * panelsPerRow];
+
+    while(numPixels > 0) {
+        const panelCalibration &calibration = rowCalibrations[x / panelWidth];
+
+        int runLength = panelWidth - (x % panelWidth);
+        if(runLength > numPixels)
+            runLength = numPixels;
+
+        if(calibration.redGain != 255 || calibration.greenGain != 255 || calibration.blueGain != 255 || calibration.offset) {
+            uint32_t redGain = calibration.redGain + 1;
+            uint32_t greenGain = calibration.greenGain + 1;
+            uint32_t blueGain = calibration.blueGain + 1;
+            int32_t offset = calibration.offset * offsetScale;
+
+            for(int i=0; i<runLength; i++) {
+                pixels[i].red = calibrateHub75Channel(pixels[i].red, redGain, offset, maxValue);
+                pixels[i].green = calibrateHub75Channel(pixels[i].green, greenGain, offset, maxValue);
+                pixels[i].blue = calibrateHub75Channel(pixels[i].blue, blueGain, offset, maxValue);
+            }
+        }
+
+        pixels += runLength;
+        x += runLength;
+        numPixels -= runLength;
+    }
+}
+
+// sum of all channels of numPixels pixels, scaled to 8-bit channels, used to estimate the power drawn by a frame
+template <typename RGB_TEMP>
+static inline uint32_t sumHub75Pixels(const RGB_TEMP * pixels, int numPixels) {
+    uint32_t sum = 0;
+
+    for(int i=0; i<numPixels; i++)
+        sum += pixels[i].red + pixels[i].green + pixels[i].blue;
+
+    return (sizeof(RGB_TEMP) <= 3) ? sum : (sum >> 8);
+}
+
+/*  Automatic brightness limiting: averageLevel is the average channel value (0-255) of the last frame, which drawn at
+    brightness out of maxBrightness gives a load of 0-255, relative to every LED on at full brightness.  Returns the scale
+    (out of 256) to apply to brightness to keep the load under maxLoad.  The scale drops right away when the load is too
+    high, and recovers over several frames, so it doesn't pump with content that's close to the limit */
+static inline uint16_t calculateHub75PowerLimitScale(uint32_t averageLevel, uint32_t brightness, uint32_t maxBrightness,
+    uint8_t maxLoad, uint16_t previousScale) {
+    uint32_t load = maxBrightness ? (averageLevel * brightness / maxBrightness) : 0;
+    uint32_t targetScale = 256;
+
+    if(load > maxLoad)
+        targetScale = (maxLoad * 256) / load;
+
+    if(targetScale <= previousScale)
+        return targetScale;
+
+    uint32_t step = (targetScale - previousScale) / 16;
+    return previousScale + (step ? step : 1);
+}
+
+#endif
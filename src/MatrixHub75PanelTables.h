@@ -0,0 +1,212 @@
+/*
+ * SmartMatrix Library - Panel Map Tables for HUB75 Refresh Buffers
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MatrixHub75PanelTables_h
+#define MatrixHub75PanelTables_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "MatrixPanelMaps.h"
+
+/*  The HUB75 calc classes build two tables in begin(), so loading a refresh row doesn't walk the panel map or work out the
+    stacking options for every row of every frame: the rows loaded from the layers for each panel in the stack, and the
+    refresh buffer position of each temp row pixel.  Both are indexed by physical row within the refresh row, which is more
+    than one for panels that need multi-row refresh. */
+
+// the ESP32 calc loads Z-shape stacks in the opposite panel order to the Teensy calcs, and offsets the rows of upside down
+// C-shape panels the other way on multi-row refresh panels, each calc keeps the order it has always used
+typedef enum hub75StackOrder {
+    hub75StackOrderTeensy,
+    hub75StackOrderEsp32
+} hub75StackOrder;
+
+// position in a panel map: the first entry of the current row offset, and the pixel group within it
+typedef struct hub75PanelMapWalker {
+    const PanelMappingEntry * map;
+    int         rowGroupIndex;
+    int         pixelGroupIndex;
+    int         panelsAlreadyMapped;
+    int         pixelOffsetFromPanelsAlreadyMapped;
+} hub75PanelMapWalker;
+
+static inline bool isLastHub75PanelMapEntry(const PanelMappingEntry &entry) {
+    return !entry.rowOffset && !entry.bufferOffset && !entry.numPixels;
+}
+
+static inline void resetHub75PanelMapPixelGroup(hub75PanelMapWalker &walker) {
+    walker.pixelGroupIndex = walker.rowGroupIndex;
+    walker.pixelOffsetFromPanelsAlreadyMapped = 0;
+    walker.panelsAlreadyMapped = 0;
+}
+
+static inline void resetHub75PanelMapWalker(hub75PanelMapWalker &walker, const PanelMappingEntry * map) {
+    walker.map = map;
+    walker.rowGroupIndex = 0;
+    resetHub75PanelMapPixelGroup(walker);
+}
+
+// returns the row offset of the current row, or -1 if we've gone through the whole map already
+static inline int getHub75PanelMapRowOffset(const hub75PanelMapWalker &walker) {
+    if(isLastHub75PanelMapEntry(walker.map[walker.rowGroupIndex]))
+        return -1;
+
+    return walker.map[walker.rowGroupIndex].rowOffset;
+}
+
+static inline void advanceHub75PanelMapToNextRow(hub75PanelMapWalker &walker) {
+    const PanelMappingEntry * map = walker.map;
+    int currentRowOffset = map[walker.rowGroupIndex].rowOffset;
+
+    // advance until end of table, or entry with new row number is found
+    while(!isLastHub75PanelMapEntry(map[walker.rowGroupIndex])) {
+        walker.rowGroupIndex++;
+
+        if(map[walker.rowGroupIndex].rowOffset != currentRowOffset)
+            break;
+    }
+
+    resetHub75PanelMapPixelGroup(walker);
+}
+
+// pixelsPerPanel is the number of refresh buffer positions taken by each panel in the chain
+static inline void advanceHub75PanelMapToNextPixelGroup(hub75PanelMapWalker &walker, int pixelsPerPanel) {
+    const PanelMappingEntry * map = walker.map;
+    int currentRowOffset = map[walker.pixelGroupIndex].rowOffset;
+
+    // don't change if we're already on the end
+    if(isLastHub75PanelMapEntry(map[walker.pixelGroupIndex]))
+        return;
+
+    if(!isLastHub75PanelMapEntry(map[walker.pixelGroupIndex + 1]) &&
+        // go to the next entry if it's in the same row offset
+        (map[walker.pixelGroupIndex + 1].rowOffset == currentRowOffset)) {
+        walker.pixelGroupIndex++;
+    } else {
+        // else we just finished mapping a panel and we're wrapping to the beginning of this row in the list
+        // keep going back until we get to the first entry, or the first entry in this row
+        while((walker.pixelGroupIndex > 0) && (map[walker.pixelGroupIndex - 1].rowOffset == currentRowOffset))
+            walker.pixelGroupIndex--;
+
+        // the next group starts at the beginning offset of the next panel
+        walker.panelsAlreadyMapped++;
+        walker.pixelOffsetFromPanelsAlreadyMapped = walker.panelsAlreadyMapped * pixelsPerPanel;
+    }
+}
+
+// fills rowSources (scanMod * physicalRowsPerRefreshRow * stackHeight entries) with the rows to load from the layers for each panel
+// in the stack, following the stacking options
+static inline void buildHub75StackedPanelRowSources(StackedPanelRowSource * rowSources, const PanelMappingEntry * map, int scanMod,
+    int physicalRowsPerRefreshRow, int stackHeight, int panelHeight, int rowPairOffset, bool cShapeStacking, bool bottomToTopStacking,
+    hub75StackOrder stackOrder) {
+    hub75PanelMapWalker walker;
+
+    for(int currentRow = 0; currentRow < scanMod; currentRow++) {
+        int physicalRow = 0;
+        int multiRowRefreshRowOffset = 0;
+
+        resetHub75PanelMapWalker(walker, map);
+
+        // go through this process for each physical row that is contained in the refresh row
+        do {
+            StackedPanelRowSource * sources = &rowSources[(currentRow * physicalRowsPerRefreshRow + physicalRow) * stackHeight];
+
+            for(int i = 0; i < stackHeight; i++) {
+                // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the
+                // furthest end of the chain (initial data is shifted out the furthest)
+                bool topPanelFirst = bottomToTopStacking;
+                if(!cShapeStacking && stackOrder == hub75StackOrderEsp32)
+                    topPanelFirst = !topPanelFirst;
+
+                int panel = topPanelFirst ? i : (stackHeight - i - 1);
+
+                // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, the last stack
+                // is always right-side up, swap row order from top to bottom for stacks an odd number of stacks away from it
+                if(cShapeStacking && ((stackHeight - i - 1) % 2)) {
+                    int flippedRow = (stackOrder == hub75StackOrderEsp32) ? (scanMod - (currentRow + multiRowRefreshRowOffset) - 1) :
+                        (scanMod - currentRow + multiRowRefreshRowOffset - 1);
+
+                    sources[i].y1 = flippedRow + panel * panelHeight;
+                    sources[i].y0 = sources[i].y1 + rowPairOffset;
+                } else {
+                    sources[i].y0 = currentRow + multiRowRefreshRowOffset + panel * panelHeight;
+                    sources[i].y1 = sources[i].y0 + rowPairOffset;
+                }
+            }
+
+            physicalRow++;
+
+            if(physicalRowsPerRefreshRow > 1) {
+                advanceHub75PanelMapToNextRow(walker);
+                multiRowRefreshRowOffset = getHub75PanelMapRowOffset(walker);
+            }
+        } while((physicalRowsPerRefreshRow > 1) && (multiRowRefreshRowOffset > 0) && (physicalRow < physicalRowsPerRefreshRow));
+    }
+}
+
+// fills refreshBufferPositions (pixelsPerLatch entries) with the position in the refresh buffer of each temp row pixel, following the
+// panel map.  The map is the same for every refresh row, it's gone through once for each physical row in the refresh row
+static inline void buildHub75RefreshBufferPositions(uint16_t * refreshBufferPositions, const PanelMappingEntry * map, int pixelsPerLatch,
+    int physicalRowsPerRefreshRow, int colsPerPanel) {
+    const int numPixelsPerTempRow = pixelsPerLatch / physicalRowsPerRefreshRow;
+    hub75PanelMapWalker walker;
+    int physicalRow = 0;
+    int multiRowRefreshRowOffset = 0;
+
+    resetHub75PanelMapWalker(walker, map);
+
+    do {
+        uint16_t * positions = &refreshBufferPositions[physicalRow * numPixelsPerTempRow];
+        int i = 0;
+
+        while(i < numPixelsPerTempRow) {
+            // get number of pixels to go through with current pass, negative if the group is written in reverse order
+            int numPixelsToMap = walker.map[walker.pixelGroupIndex].numPixels;
+
+            bool reversePixelBlock = false;
+            if(numPixelsToMap < 0) {
+                reversePixelBlock = true;
+                numPixelsToMap = abs(numPixelsToMap);
+            }
+
+            // get offset where pixels are written in the refresh buffer
+            int currentMapOffset = walker.map[walker.pixelGroupIndex].bufferOffset + walker.pixelOffsetFromPanelsAlreadyMapped;
+
+            for(int k=0; (k < numPixelsToMap) && (i+k < numPixelsPerTempRow); k++) {
+                if(reversePixelBlock) {
+                    positions[i+k] = currentMapOffset-k;
+                } else {
+                    positions[i+k] = currentMapOffset+k;
+                }
+            }
+
+            i += numPixelsToMap; // keep track of current position on this temp buffer
+            advanceHub75PanelMapToNextPixelGroup(walker, colsPerPanel * physicalRowsPerRefreshRow);
+        }
+
+        physicalRow++;
+        advanceHub75PanelMapToNextRow(walker);
+        multiRowRefreshRowOffset = getHub75PanelMapRowOffset(walker);
+    } while((multiRowRefreshRowOffset > 0) && (physicalRow < physicalRowsPerRefreshRow));
+}
+
+#endif
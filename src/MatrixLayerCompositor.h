@@ -0,0 +1,146 @@
+/*
+ * SmartMatrix Library - Layer Compositor
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef MatrixLayerCompositor_h
+#define MatrixLayerCompositor_h
+
+/*  Fills a refresh row from a chain of layers.  The layers' row coverage is read top-down first, so a layer under opaque
+    spans of the layers above only fills the range of pixels left uncovered, and isn't filled at all when the row is fully
+    covered.  The layers are then filled bottom-up as before, so layers that can't fill part of a row still composite
+    correctly: they fill the whole row and the covering layers overwrite it.  Only pixels no layer covers are cleared. */
+
+// chains longer than this are filled bottom-up without reading coverage
+#ifndef SM_COMPOSITOR_MAX_LAYERS
+#define SM_COMPOSITOR_MAX_LAYERS    8
+#endif
+
+// calc tasks that can fill rows at the same time, each gets its own scratch space
+#define SM_COMPOSITOR_MAX_CONTEXTS  2
+
+// use a dummy template, as a way to allow class to be defined in header and not separate .cpp file (the .cpp wouldn't see the sketch's #define)
+template <int dummyvar>
+class SmartMatrixLayerCompositorBase {
+public:
+    // fills rowWidth pixels of refreshRow from hardware row hardwareY, profileContext is the calc task filling the row
+    // (0 to SM_COMPOSITOR_MAX_CONTEXTS-1), selecting its scratch space and where the fill times are recorded
+    static void fillRefreshRow(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, rgb48 refreshRow[], int brightnessShifts = 0, int profileContext = 0);
+    static void fillRefreshRow(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, rgb24 refreshRow[], int brightnessShifts = 0, int profileContext = 0);
+
+private:
+    template <typename RGB_OUT>
+    static void fillRefreshRowTemplated(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, RGB_OUT refreshRow[], int brightnessShifts, int profileContext);
+
+    // kept out of the calc task stacks
+    struct compositorScratchStruct {
+        SM_Layer * layers[SM_COMPOSITOR_MAX_LAYERS];
+        // range of pixels each layer needs to fill, empty if the layer is skipped
+        uint16_t fillFirstX[SM_COMPOSITOR_MAX_LAYERS];
+        uint16_t fillEndX[SM_COMPOSITOR_MAX_LAYERS];
+    };
+    static compositorScratchStruct scratch[SM_COMPOSITOR_MAX_CONTEXTS];
+};
+
+template <int dummyvar> typename SmartMatrixLayerCompositorBase<dummyvar>::compositorScratchStruct SmartMatrixLayerCompositorBase<dummyvar>::scratch[SM_COMPOSITOR_MAX_CONTEXTS];
+
+typedef SmartMatrixLayerCompositorBase<0> SmartMatrixLayerCompositor;
+
+template <int dummyvar> template <typename RGB_OUT>
+void SmartMatrixLayerCompositorBase<dummyvar>::fillRefreshRowTemplated(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, RGB_OUT refreshRow[], int brightnessShifts, int profileContext) {
+    SM_Layer ** layers = scratch[profileContext].layers;
+    uint16_t * fillFirstX = scratch[profileContext].fillFirstX;
+    uint16_t * fillEndX = scratch[profileContext].fillEndX;
+    int numLayers = 0;
+    int i;
+
+    SM_Layer * templayer = baseLayer;
+    while(templayer) {
+        if(numLayers == SM_COMPOSITOR_MAX_LAYERS) {
+            // clear buffer to prevent garbage data showing through transparent layers
+            memset((void *)refreshRow, 0x00, sizeof(RGB_OUT) * rowWidth);
+
+            for(templayer = baseLayer; templayer; templayer = templayer->nextLayer) {
+                SM_CALC_PROFILE_START(fillStartTicks);
+                templayer->fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+                SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, templayer, profileContext, SM_CALC_PROFILE_ELAPSED(fillStartTicks));
+            }
+            return;
+        }
+
+        layers[numLayers++] = templayer;
+        templayer = templayer->nextLayer;
+    }
+
+    // pixels not covered by the layers above, kept as a single range: an opaque span in the middle of the range doesn't shrink it
+    uint16_t uncoveredFirstX = 0;
+    uint16_t uncoveredEndX = rowWidth;
+
+    for(i = numLayers - 1; i >= 0; i--) {
+        fillFirstX[i] = uncoveredFirstX;
+        fillEndX[i] = uncoveredEndX;
+
+        if(uncoveredFirstX >= uncoveredEndX)
+            continue;
+
+        layerRowCoverage coverage;
+        layers[i]->getRowCoverage(hardwareY, coverage);
+
+        if(!coverage.drawsPixels) {
+            fillEndX[i] = fillFirstX[i];
+            continue;
+        }
+
+        if(coverage.opaqueFirstX <= uncoveredFirstX && coverage.opaqueEndX > uncoveredFirstX)
+            uncoveredFirstX = min(coverage.opaqueEndX, uncoveredEndX);
+        if(coverage.opaqueEndX >= uncoveredEndX && coverage.opaqueFirstX < uncoveredEndX)
+            uncoveredEndX = max(coverage.opaqueFirstX, uncoveredFirstX);
+    }
+
+    // clear pixels no layer covers to prevent garbage data showing through transparent layers
+    if(uncoveredFirstX < uncoveredEndX)
+        memset((void *)&refreshRow[uncoveredFirstX], 0x00, sizeof(RGB_OUT) * (uncoveredEndX - uncoveredFirstX));
+
+    for(i = 0; i < numLayers; i++) {
+        if(fillFirstX[i] >= fillEndX[i])
+            continue;
+
+        SM_CALC_PROFILE_START(fillStartTicks);
+        if((fillFirstX[i] > 0 || fillEndX[i] < rowWidth) && layers[i]->hasRefreshPixels())
+            layers[i]->fillRefreshPixels(fillFirstX[i], hardwareY, fillEndX[i] - fillFirstX[i], &refreshRow[fillFirstX[i]], brightnessShifts);
+        else
+            layers[i]->fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+        SM_CALC_PROFILE_ADD(calcStageFillRefreshRow, layers[i], profileContext, SM_CALC_PROFILE_ELAPSED(fillStartTicks));
+    }
+}
+
+template <int dummyvar>
+void SmartMatrixLayerCompositorBase<dummyvar>::fillRefreshRow(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, rgb48 refreshRow[], int brightnessShifts, int profileContext) {
+    fillRefreshRowTemplated(baseLayer, hardwareY, rowWidth, refreshRow, brightnessShifts, profileContext);
+}
+
+template <int dummyvar>
+void SmartMatrixLayerCompositorBase<dummyvar>::fillRefreshRow(SM_Layer * baseLayer, uint16_t hardwareY, uint16_t rowWidth, rgb24 refreshRow[], int brightnessShifts, int profileContext) {
+    fillRefreshRowTemplated(baseLayer, hardwareY, rowWidth, refreshRow, brightnessShifts, profileContext);
+}
+
+#endif
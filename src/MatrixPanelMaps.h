@@ -30,6 +30,12 @@ typedef struct PanelMappingEntry {
     int         numPixels;
 } PanelMappingEntry;
 
+// rows of the matrix loaded into the two HUB75 color channels (R0/G0/B0 and R1/G1/B1) for one panel in a stack
+typedef struct StackedPanelRowSource {
+    int         y0;
+    int         y1;
+} StackedPanelRowSource;
+
 const PanelMappingEntry * getMultiRowRefreshPanelMap(unsigned char panelType);
 
 #endif
@@ -38,10 +38,15 @@ public:
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
     void setRefreshRate(uint8_t newRefreshRate);
+    void setPanelCalibration(uint16_t panelIndex, const panelCalibration &calibration);
+    void loadPanelCalibration(const panelCalibration * calibrations);
+    void clearPanelCalibration(void);
+    void setPowerLimit(uint8_t maxLoad);
 
     // get info
     uint16_t getScreenWidth(void) const;
     uint16_t getScreenHeight(void) const;
+    uint16_t getNumPanels(void) const;
     uint8_t getRefreshRate(void);
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
@@ -60,13 +65,9 @@ private:
     static void loadMatrixBuffers(unsigned char currentRow);
     template <typename RGB_TEMP>
     static void loadMatrixBuffers48(rowDataStruct * currentRowDataPtr, unsigned char currentRow, RGB_TEMP tempBufferType);
-    static void resetMultiRowRefreshMapPosition(void);
-    static void resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void);
-    static void advanceMultiRowRefreshMapToNextRow(void);
-    static void advanceMultiRowRefreshMapToNextPixelGroup(void);
-    static int getMultiRowRefreshRowOffset(void);
-    static int getMultiRowRefreshNumPixelsToMap(void);
-    static int getMultiRowRefreshPixelGroupOffset(void);
+    static void buildColorIndexWords(void);
+    static void buildStackedPanelRowSources(void);
+    static void buildRefreshBufferPositions(void);
 
     // configuration
     static volatile bool brightnessChange;
@@ -78,11 +79,22 @@ private:
     static bool dmaBufferUnderrunSinceLastCheck;
     static bool refreshRateLowered;
     static bool refreshRateChanged;
+    // advanced once per frame, selects the SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING thresholds
+    static uint8_t ditherFrameCount;
+    // gain and offset for each panel, applied to the rows before bitplane extraction while panelCalibrationEnabled is set
+    static panelCalibration panelCalibrations[MATRIX_NUM_PANELS];
+    static volatile bool panelCalibrationEnabled;
+    // automatic brightness limiting, see setPowerLimit()
+    static uint8_t powerLimitMaxLoad;
+    static uint16_t powerLimitScale;
+    static uint32_t powerLimitFrameSum;
 
-    static int multiRowRefresh_mapIndex_CurrentRowGroups;
-    static int multiRowRefresh_mapIndex_CurrentPixelGroup;
-    static int multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
-    static int multiRowRefresh_NumPanelsAlreadyMapped;
+    // GPIO words (without and with clock) for each color index returned by extractHub75Bitplanes()
+    static uint8_t colorIndexWords[HUB75_COLOR_INDEX_COUNT][DMA_UPDATES_PER_CLOCK];
+    // matrix rows to load for each (refresh row, physical row in refresh row, stacked panel), depends only on panelType and stacking options
+    static StackedPanelRowSource stackedPanelRowSources[MATRIX_SCAN_MOD * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
+    // refresh buffer position for each (physical row in refresh row, temp row pixel), the panel map flattened so it isn't walked for every row
+    static uint16_t refreshBufferPositions[MULTI_ROW_REFRESH_REQUIRED ? PIXELS_PER_LATCH : 1];
 };
 
 #endif
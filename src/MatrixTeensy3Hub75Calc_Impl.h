@@ -44,16 +44,31 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateChanged = true;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrameCount = 0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentPixelGroup = -1;
+panelCalibration SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrations[MATRIX_NUM_PANELS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrationEnabled = false;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_NumPanelsAlreadyMapped = 0;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitMaxLoad = 255;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitScale = 256;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitFrameSum = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+StackedPanelRowSource SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stackedPanelRowSources[MATRIX_SCAN_MOD * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshBufferPositions[MULTI_ROW_REFRESH_REQUIRED ? PIXELS_PER_LATCH : 1];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::colorIndexWords[HUB75_COLOR_INDEX_COUNT][DMA_UPDATES_PER_CLOCK];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Calc(uint8_t bufferrows, rowDataStruct * rowDataBuffer) {
@@ -121,6 +136,8 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
         // do once-per-frame updates
         if (!currentRow) {
+            SM_CALC_PROFILE_BEGIN_FRAME();
+
             if (rotationChange) {
                 SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                 while(templayer) {
@@ -135,12 +152,25 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
                 if(refreshRateChanged) {
                     templayer->setRefreshRate(calc_refreshRate);
                 }
+                SM_CALC_PROFILE_START(callbackStartTicks);
                 templayer->frameRefreshCallback();
+                SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, templayer, 0, SM_CALC_PROFILE_ELAPSED(callbackStartTicks));
                 templayer = templayer->nextLayer;
             }
             refreshRateChanged = false;
+            ditherFrameCount++;
+
+            // limit brightness using the load estimated while loading the last frame
+            uint16_t newPowerLimitScale = calculateHub75PowerLimitScale(powerLimitFrameSum / (matrixWidth * matrixHeight * COLOR_CHANNELS_PER_PIXEL),
+                brightness, 255, powerLimitMaxLoad, powerLimitScale);
+            powerLimitFrameSum = 0;
+            if (newPowerLimitScale != powerLimitScale) {
+                powerLimitScale = newPowerLimitScale;
+                brightnessChange = true;
+            }
+
             if (brightnessChange) {
-                SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(brightness);
+                SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness((brightness * powerLimitScale) >> 8);
                 brightnessChange = false;
             }
         }
@@ -149,8 +179,17 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
         // none right now
 
         // enqueue row
+        SM_CALC_PROFILE_START(packStartTicks);
         SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(currentRow);
+        SM_CALC_PROFILE_ADD(calcStageBitplanePacking, NULL, 0, SM_CALC_PROFILE_ELAPSED(packStartTicks));
+
+        SM_CALC_PROFILE_START(handoffStartTicks);
         SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(currentRow);
+        SM_CALC_PROFILE_ADD(calcStageBufferHandoff, NULL, 0, SM_CALC_PROFILE_ELAPSED(handoffStartTicks));
+
+        if (currentRow == MATRIX_SCAN_MOD - 1) {
+            SM_CALC_PROFILE_END_FRAME();
+        }
 
         if (++currentRow >= MATRIX_SCAN_MOD)
             currentRow = 0;
@@ -195,6 +234,48 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
     }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNumPanels(void) const {
+    return MATRIX_NUM_PANELS;
+}
+
+// panels that haven't been given a calibration yet are left unchanged
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelCalibration(uint16_t panelIndex, const panelCalibration &calibration) {
+    if(panelIndex >= MATRIX_NUM_PANELS)
+        return;
+
+    if(!panelCalibrationEnabled) {
+        const panelCalibration noCalibration = SM_PANEL_CALIBRATION_NONE;
+        for(int i=0; i<MATRIX_NUM_PANELS; i++)
+            panelCalibrations[i] = noCalibration;
+    }
+
+    panelCalibrations[panelIndex] = calibration;
+    panelCalibrationEnabled = true;
+}
+
+// loads a table of getNumPanels() entries, e.g. one saved to EEPROM or flash
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadPanelCalibration(const panelCalibration * calibrations) {
+    for(int i=0; i<MATRIX_NUM_PANELS; i++)
+        panelCalibrations[i] = calibrations[i];
+
+    panelCalibrationEnabled = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelCalibration(void) {
+    panelCalibrationEnabled = false;
+}
+
+// limits brightness so the estimated current stays under maxLoad/255 of the current drawn with every LED fully on at
+// full brightness, e.g. 127 for a matrix that draws 40A at full white on a 20A supply.  255 disables the limit
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPowerLimit(uint8_t maxLoad) {
+    powerLimitMaxLoad = maxLoad;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessChange = false;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -202,8 +283,9 @@ volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, pane
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
 
+// matches the refresh class default of full brightness, so the power limit has the right starting point
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness;
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness = 255;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
@@ -253,173 +335,105 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
         templayer = templayer->nextLayer;
     }
 
+    buildColorIndexWords();
+    buildStackedPanelRowSources();
+    if(MULTI_ROW_REFRESH_REQUIRED)
+        buildRefreshBufferPositions();
+
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculations);
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixUnderrunCallback(dmaBufferUnderrunCallback);
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin();
 }
 
-#define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
-
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPosition(void) {   
-    multiRowRefresh_mapIndex_CurrentRowGroups = 0;
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-}
-
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
-    multiRowRefresh_mapIndex_CurrentPixelGroup = multiRowRefresh_mapIndex_CurrentRowGroups;
-    multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
-    multiRowRefresh_NumPanelsAlreadyMapped = 0;
-}
-
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextRow(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;
-
-    // advance until end of table, or entry with new row nubmer is found
-    while(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])) {
-        multiRowRefresh_mapIndex_CurrentRowGroups++;
-
-        if(map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset != currentRowOffset)
-            break;
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildColorIndexWords(void) {
+    union {
+        uint8_t word;
+        struct {
+            // order of bits in word matches how GPIO connects to the display
+            uint8_t GPIO_WORD_ORDER_8BIT;
+        };
+    } o0;
+
+    for(int index=0; index < HUB75_COLOR_INDEX_COUNT; index++) {
+        // HUB12 format inverts the data (assume we're only using R1 for now)
+        int colorBits = index;
+        if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE)
+            colorBits ^= HUB75_COLOR_INDEX_R0;
+
+        o0.word = 0x00;
+
+        if (colorBits & HUB75_COLOR_INDEX_R0)
+            o0.hub75_r0 = 1;
+        if (colorBits & HUB75_COLOR_INDEX_G0)
+            o0.hub75_g0 = 1;
+        if (colorBits & HUB75_COLOR_INDEX_B0)
+            o0.hub75_b0 = 1;
+        if (colorBits & HUB75_COLOR_INDEX_R1)
+            o0.hub75_r1 = 1;
+        if (colorBits & HUB75_COLOR_INDEX_G1)
+            o0.hub75_g1 = 1;
+        if (colorBits & HUB75_COLOR_INDEX_B1)
+            o0.hub75_b1 = 1;
+
+        // pixel data is written twice, the second time with the clock set
+        colorIndexWords[index][0] = o0.word;
+        o0.hub75_clk = 1;
+        colorIndexWords[index][1] = o0.word;
     }
-
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 }
 
+// fills stackedPanelRowSources with the rows to load from the layers for each panel in the stack, following the stacking options
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentPixelGroup].rowOffset;
-
-    // don't change if we're already on the end
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup])) {
-        return;
-    }
-
-    if(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1]) &&
-        // go to the next entry if it's in the same row offset
-        (map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1].rowOffset == currentRowOffset)) {
-        multiRowRefresh_mapIndex_CurrentPixelGroup++;
-    } else {
-        // else we just finished mapping a panel and we're wrapping to the beginning of this row in the list
-        // keep going back until we get to the first entry, or the first entry in this row
-        while((multiRowRefresh_mapIndex_CurrentPixelGroup > 0) && (map[multiRowRefresh_mapIndex_CurrentPixelGroup - 1].rowOffset == currentRowOffset))
-            multiRowRefresh_mapIndex_CurrentPixelGroup--;
-
-        // we need to set the total offset to the beginning offset of the next panel.  Calculate what that would be
-        multiRowRefresh_NumPanelsAlreadyMapped++;
-        multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = multiRowRefresh_NumPanelsAlreadyMapped * COLS_PER_PANEL * PHYSICAL_ROWS_PER_REFRESH_ROW;
-    }
-}
-
-// returns the row offset from the map, or -1 if we've gone through the whole map already
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshRowOffset(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])){
-        return -1;
-    }
-
-    return map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;    
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildStackedPanelRowSources(void) {
+    buildHub75StackedPanelRowSources(stackedPanelRowSources, getMultiRowRefreshPanelMap(panelType), MATRIX_SCAN_MOD,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, MATRIX_STACK_HEIGHT, MATRIX_PANEL_HEIGHT, ROW_PAIR_OFFSET,
+        (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING), (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING),
+        hub75StackOrderTeensy);
 }
 
+// fills refreshBufferPositions with the position in the refresh buffer of each temp row pixel, following the panel map
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshNumPixelsToMap(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].numPixels;    
-}
-
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshPixelGroupOffset(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildRefreshBufferPositions(void) {
+    buildHub75RefreshBufferPositions(refreshBufferPositions, getMultiRowRefreshPanelMap(panelType), PIXELS_PER_LATCH,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, COLS_PER_PANEL);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags> template <typename RGB_TEMP>
 INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(rowDataStruct * currentRowDataPtr, unsigned char currentRow, RGB_TEMP tempBufferType) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
     // static to avoid putting large buffer on the stack
     static RGB_TEMP tempRow0[numPixelsPerTempRow];
     static RGB_TEMP tempRow1[numPixelsPerTempRow];
 
-    int c = 0;
-
-    // multi row refresh isn't very efficient, slowing this function down by ~30% for panels that don't even need multi row refresh.  For now, only enable the code if needed
-    if(MULTI_ROW_REFRESH_REQUIRED) { 
-        resetMultiRowRefreshMapPosition();
-    }
-
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset((void *)tempRow0, 0x00, sizeof(tempRow0));
-        memset((void *)tempRow1, 0x00, sizeof(tempRow1));
-
-        // get pixel data from layers
-        SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-        int y0, y1; // positions of the two rows we need
-        while (templayer) {
-            for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
-                // Z-shape, bottom to top
-                if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                        (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + i * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // Z-shape, top to bottom
-                } else if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // C-shape, bottom to top
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (i) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (i) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
-                // C-shape, top to bottom
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
-                }
-                templayer->fillRefreshRow(y0, &tempRow0[i * matrixWidth]);
-                templayer->fillRefreshRow(y1, &tempRow1[i * matrixWidth]);
+    for(int physicalRow = 0; physicalRow < PHYSICAL_ROWS_PER_REFRESH_ROW; physicalRow++) {
+        // get pixel data from layers, using the rows calculated for each stacked panel by buildStackedPanelRowSources()
+        // the compositor clears the pixels no layer covers
+        const StackedPanelRowSource * rowSources = &stackedPanelRowSources[(currentRow * PHYSICAL_ROWS_PER_REFRESH_ROW + physicalRow) * MATRIX_STACK_HEIGHT];
+        for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+            SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y0, matrixWidth, &tempRow0[i * matrixWidth]);
+            SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y1, matrixWidth, &tempRow1[i * matrixWidth]);
+
+            if(panelCalibrationEnabled) {
+                calibrateHub75Pixels(&tempRow0[i * matrixWidth], matrixWidth, 0, rowSources[i].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                calibrateHub75Pixels(&tempRow1[i * matrixWidth], matrixWidth, 0, rowSources[i].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+            }
+
+            if(powerLimitMaxLoad < 255)
+                powerLimitFrameSum += sumHub75Pixels(&tempRow0[i * matrixWidth], matrixWidth) + sumHub75Pixels(&tempRow1[i * matrixWidth], matrixWidth);
+
+            // carry the bits below COLOR_DEPTH_BITS across frames instead of dropping them
+            if((optionFlags & SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING) && sizeof(RGB_TEMP) > 3 && COLOR_DEPTH_BITS < 16) {
+                temporalDitherHub75Row(&tempRow0[i * matrixWidth], matrixWidth, rowSources[i].y0, ditherFrameCount, 16 - COLOR_DEPTH_BITS);
+                temporalDitherHub75Row(&tempRow1[i * matrixWidth], matrixWidth, rowSources[i].y1, ditherFrameCount, 16 - COLOR_DEPTH_BITS);
+            } else if((optionFlags & SMARTMATRIX_OPTIONS_SPATIAL_DITHERING) && sizeof(RGB_TEMP) > 3 && COLOR_DEPTH_BITS < 16) {
+                // or spread them over neighbouring pixels
+                orderedDitherHub75Row(&tempRow0[i * matrixWidth], matrixWidth, 0, rowSources[i].y0, 0, 16 - COLOR_DEPTH_BITS);
+                orderedDitherHub75Row(&tempRow1[i * matrixWidth], matrixWidth, 0, rowSources[i].y1, 0, 16 - COLOR_DEPTH_BITS);
             }
-            templayer = templayer->nextLayer;        
         }
 
         union {
@@ -432,108 +446,46 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
                 uint8_t GPIO_WORD_ORDER_ADDX_8BIT;                
             };
         } o0;
-        
-        int i=0;
 
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-        }
-
-        while(i < numPixelsPerTempRow) {
-            int numPixelsToMap;
-            int currentMapOffset;
-            bool reversePixelBlock;
+        // multi row refresh panels write pixels to the positions calculated by buildRefreshBufferPositions(), other panels write pixels in order
+        const uint16_t * positions = &refreshBufferPositions[MULTI_ROW_REFRESH_REQUIRED ? physicalRow * numPixelsPerTempRow : 0];
 
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                // get number of pixels to go through with current pass
-                numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+        // parse through the temp rows in blocks, extracting all bitplanes of a block at once and writing them to the refresh buffer
+        int numBlockPixels;
+        for(i=0; i < numPixelsPerTempRow; i += numBlockPixels) {
+            int ind, step;
 
-                reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
+            // keep each block within one stack, so upside down stacks can be read in reverse
+            int currentStack = i/matrixWidth;
+            numBlockPixels = min(HUB75_BITPLANE_BLOCK_PIXELS, numPixelsPerTempRow - i);
+            numBlockPixels = min(numBlockPixels, matrixWidth - (i%matrixWidth));
 
-                // get offset where pixels are written in the refresh buffer
-                currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+            // for upside down stacks, flip order
+            if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
+                // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
+                ind = (currentStack*matrixWidth) + (matrixWidth-1) - (i%matrixWidth);
+                step = -1;
             } else {
-                numPixelsToMap = matrixWidth;
+                // load data to buffer in normal order
+                ind = i;
+                step = 1;
             }
 
-            // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-            for(int k=0; k < numPixelsToMap; k++) {
-                uint16_t r0, g0, b0, r1, g1, b1;
-                int ind;
-
-                int refreshBufferPosition;
-                if(MULTI_ROW_REFRESH_REQUIRED) { 
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
-                } else {
-                    refreshBufferPosition = i+k;
-                }
+            // extract the bitplanes used at this color depth, the MSBs of the source color
+            int sizeOfSourceColor = (sizeof(RGB_TEMP) <= 3) ? 8 : 16;
+            uint8_t bitplanes[COLOR_DEPTH_BITS][HUB75_BITPLANE_BLOCK_PIXELS];
+            extractHub75Bitplanes(&tempRow0[ind], &tempRow1[ind], step, numBlockPixels, sizeOfSourceColor - COLOR_DEPTH_BITS, COLOR_DEPTH_BITS, bitplanes);
 
-                // for upside down stacks, flip order
-                int currentStack = i/matrixWidth;
-                if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
-                    // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
-                    ind = (currentStack*matrixWidth) + (matrixWidth-1) - ((i+k)%matrixWidth);
-                } else {
-                    // load data to buffer in normal order
-                    ind = i+k;
-                }
-                r0 = tempRow0[ind].red;
-                g0 = tempRow0[ind].green;
-                b0 = tempRow0[ind].blue;
-                r1 = tempRow1[ind].red;
-                g1 = tempRow1[ind].green;
-                b1 = tempRow1[ind].blue;
-
-                // loop through each bitplane in the current pixel's RGB values and format the bits to match the FlexIO pin configuration
-                int sizeOfSourceColor = (sizeof(RGB_TEMP) <= 3) ? 8 : 16;
-                uint8_t shift = (sizeOfSourceColor - COLOR_DEPTH_BITS);
-                uint16_t mask = 1 << shift;
+            for(int b=0; b < numBlockPixels; b++) {
+                int refreshBufferPosition = MULTI_ROW_REFRESH_REQUIRED ? positions[i+b] : i+b;
 
                 for (int bitindex = 0; bitindex < COLOR_DEPTH_BITS; bitindex++) {
-                    o0.word = 0x00;
-
-                    if (r0 & mask)
-                        o0.hub75_r0 = 1;
-                    if (g0 & mask)
-                        o0.hub75_g0 = 1;
-                    if (b0 & mask)
-                        o0.hub75_b0 = 1;
-                    if (r1 & mask)
-                        o0.hub75_r1 = 1;
-                    if (g1 & mask)
-                        o0.hub75_g1 = 1;
-                    if (b1 & mask)
-                        o0.hub75_b1 = 1;
-
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now)
-                        if (r0 & mask)
-                            o0.hub75_r0 = 0;
-                        else
-                            o0.hub75_r0 = 1;                        
-                    }               
-
-                    mask <<= 1;
-
-                    // store these pixel bits in the rowDataBuffer, leaving the initial pixels as padding
-                    currentRowDataPtr->rowbits[bitindex].data[((refreshBufferPosition)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                    o0.hub75_clk = 1;
-                    currentRowDataPtr->rowbits[bitindex].data[((refreshBufferPosition)*DMA_UPDATES_PER_CLOCK)+1] = o0.word;
+                    // store these pixel bits in the rowDataBuffer, first without and then with the clock set
+                    const uint8_t * words = colorIndexWords[bitplanes[bitindex][b]];
+                    currentRowDataPtr->rowbits[bitindex].data[((refreshBufferPosition)*DMA_UPDATES_PER_CLOCK)] = words[0];
+                    currentRowDataPtr->rowbits[bitindex].data[((refreshBufferPosition)*DMA_UPDATES_PER_CLOCK)+1] = words[1];
                 }
             }
-            i += numPixelsToMap; // keep track of current position on this temp buffer
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                advanceMultiRowRefreshMapToNextPixelGroup();
-            }
         }
 
         unsigned int addressbits;
@@ -558,14 +510,7 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
             currentRowDataPtr->rowbits[bitindex].rowAddress = o0.word;
         }
 #endif
-
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
-
-            advanceMultiRowRefreshMapToNextRow();
-            multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-        }
-    } while (MULTI_ROW_REFRESH_REQUIRED ? (multiRowRefreshRowOffset > 0) : 0);
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -573,7 +518,8 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
     rowDataStruct * currentRowDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferPtr();
 
     // same function supports any refresh depth up to 48, choose between rgb24 and rgb48 for temporary storage to save RAM
-    if(COLOR_DEPTH_BITS <= 8)
+    // dithering needs the bits below COLOR_DEPTH_BITS, so it always uses rgb48
+    if(COLOR_DEPTH_BITS <= 8 && !(optionFlags & (SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING | SMARTMATRIX_OPTIONS_SPATIAL_DITHERING)))
         loadMatrixBuffers48(currentRowDataPtr, currentRow, rgb24(0,0,0));
     else
         loadMatrixBuffers48(currentRowDataPtr, currentRow, rgb48(0,0,0));
@@ -50,20 +50,36 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotationChange = true;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
+// matches the refresh class default of full brightness, so the power limit has the right starting point
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness = 255;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrameCount = 0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentPixelGroup = -1;
+panelCalibration SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrations[MATRIX_NUM_PANELS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelCalibrationEnabled = false;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_NumPanelsAlreadyMapped = 0;
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitMaxLoad = 255;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitScale = 256;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimitFrameSum = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+StackedPanelRowSource SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stackedPanelRowSources[MATRIX_SCAN_MOD * PHYSICAL_ROWS_PER_REFRESH_ROW * MATRIX_STACK_HEIGHT];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshBufferPositions[MULTI_ROW_REFRESH_REQUIRED ? PIXELS_PER_LATCH : 1];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::colorIndexWords[HUB75_COLOR_INDEX_COUNT];
 
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -138,6 +154,8 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
 
         // do once-per-frame updates
         if (!currentRow) {
+            SM_CALC_PROFILE_BEGIN_FRAME();
+
             if (rotationChange) {
                 SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                 while (templayer) {
@@ -151,12 +169,25 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
                 if (refreshRateChanged) {
                     templayer->setRefreshRate(calc_refreshRate);
                 }
+                SM_CALC_PROFILE_START(callbackStartTicks);
                 templayer->frameRefreshCallback();
+                SM_CALC_PROFILE_ADD(calcStageFrameRefreshCallback, templayer, 0, SM_CALC_PROFILE_ELAPSED(callbackStartTicks));
                 templayer = templayer->nextLayer;
             }
             refreshRateChanged = false;
+            ditherFrameCount++;
+
+            // limit brightness using the load estimated while loading the last frame
+            uint16_t newPowerLimitScale = calculateHub75PowerLimitScale(powerLimitFrameSum / (matrixWidth * matrixHeight * COLOR_CHANNELS_PER_PIXEL),
+                brightness, 255, powerLimitMaxLoad, powerLimitScale);
+            powerLimitFrameSum = 0;
+            if (newPowerLimitScale != powerLimitScale) {
+                powerLimitScale = newPowerLimitScale;
+                brightnessChange = true;
+            }
+
             if (brightnessChange) {
-                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(brightness);
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness((brightness * powerLimitScale) >> 8);
                 brightnessChange = false;
             }
         }
@@ -165,8 +196,17 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
         // none right now
 
         // enqueue row
+        SM_CALC_PROFILE_START(packStartTicks);
         SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(currentRow);
+        SM_CALC_PROFILE_ADD(calcStageBitplanePacking, NULL, 0, SM_CALC_PROFILE_ELAPSED(packStartTicks));
+
+        SM_CALC_PROFILE_START(handoffStartTicks);
         SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(currentRow);
+        SM_CALC_PROFILE_ADD(calcStageBufferHandoff, NULL, 0, SM_CALC_PROFILE_ELAPSED(handoffStartTicks));
+
+        if (currentRow == MATRIX_SCAN_MOD - 1) {
+            SM_CALC_PROFILE_END_FRAME();
+        }
 
         if (++currentRow >= MATRIX_SCAN_MOD) currentRow = 0;
 
@@ -212,6 +252,48 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
     }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNumPanels(void) const {
+    return MATRIX_NUM_PANELS;
+}
+
+// panels that haven't been given a calibration yet are left unchanged
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelCalibration(uint16_t panelIndex, const panelCalibration &calibration) {
+    if(panelIndex >= MATRIX_NUM_PANELS)
+        return;
+
+    if(!panelCalibrationEnabled) {
+        const panelCalibration noCalibration = SM_PANEL_CALIBRATION_NONE;
+        for(int i=0; i<MATRIX_NUM_PANELS; i++)
+            panelCalibrations[i] = noCalibration;
+    }
+
+    panelCalibrations[panelIndex] = calibration;
+    panelCalibrationEnabled = true;
+}
+
+// loads a table of getNumPanels() entries, e.g. one saved to EEPROM or flash
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadPanelCalibration(const panelCalibration * calibrations) {
+    for(int i=0; i<MATRIX_NUM_PANELS; i++)
+        panelCalibrations[i] = calibrations[i];
+
+    panelCalibrationEnabled = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelCalibration(void) {
+    panelCalibrationEnabled = false;
+}
+
+// limits brightness so the estimated current stays under maxLoad/255 of the current drawn with every LED fully on at
+// full brightness, e.g. 127 for a matrix that draws 40A at full white on a 20A supply.  255 disables the limit
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPowerLimit(uint8_t maxLoad) {
+    powerLimitMaxLoad = maxLoad;
+}
+
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
@@ -267,94 +349,56 @@ FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, pane
         templayer = templayer->nextLayer;
     }
 
+    buildStackedPanelRowSources();
+    if(MULTI_ROW_REFRESH_REQUIRED)
+        buildRefreshBufferPositions();
+
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculations);
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixUnderrunCallback(dmaBufferUnderrunCallback);
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin();
-}
-
-#define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
 
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPosition(void) {   
-    multiRowRefresh_mapIndex_CurrentRowGroups = 0;
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+    // the FlexIO pin configuration is only known after SmartMatrixRefreshT4::begin() sets up the hardware
+    buildColorIndexWords();
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
-    multiRowRefresh_mapIndex_CurrentPixelGroup = multiRowRefresh_mapIndex_CurrentRowGroups;
-    multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
-    multiRowRefresh_NumPanelsAlreadyMapped = 0;
-}
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildColorIndexWords(void) {
+    const typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct & pins =
+        SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig();
 
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextRow(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+    for (int index = 0; index < HUB75_COLOR_INDEX_COUNT; index++) {
+        uint16_t rgbdata = 0;
 
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;
+        // HUB12 format inverts the data (assume we're only using R1 for now)
+        int colorBits = index;
+        if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE)
+            colorBits ^= HUB75_COLOR_INDEX_R0;
 
-    // advance until end of table, or entry with new row nubmer is found
-    while(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])) {
-        multiRowRefresh_mapIndex_CurrentRowGroups++;
+        if (colorBits & HUB75_COLOR_INDEX_R0) rgbdata |= 1 << pins.r0;
+        if (colorBits & HUB75_COLOR_INDEX_G0) rgbdata |= 1 << pins.g0;
+        if (colorBits & HUB75_COLOR_INDEX_B0) rgbdata |= 1 << pins.b0;
+        if (colorBits & HUB75_COLOR_INDEX_R1) rgbdata |= 1 << pins.r1;
+        if (colorBits & HUB75_COLOR_INDEX_G1) rgbdata |= 1 << pins.g1;
+        if (colorBits & HUB75_COLOR_INDEX_B1) rgbdata |= 1 << pins.b1;
 
-        if(map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset != currentRowOffset)
-            break;
+        colorIndexWords[index] = rgbdata;
     }
-
-    resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 }
 
+// fills stackedPanelRowSources with the rows to load from the layers for each panel in the stack, following the stacking options
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentPixelGroup].rowOffset;
-
-    // don't change if we're already on the end
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup])) {
-        return;
-    }
-
-    if(!IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1]) &&
-        // go to the next entry if it's in the same row offset
-        (map[multiRowRefresh_mapIndex_CurrentPixelGroup + 1].rowOffset == currentRowOffset)) {
-        multiRowRefresh_mapIndex_CurrentPixelGroup++;
-    } else {
-        // else we just finished mapping a panel and we're wrapping to the beginning of this row in the list
-        // keep going back until we get to the first entry, or the first entry in this row
-        while((multiRowRefresh_mapIndex_CurrentPixelGroup > 0) && (map[multiRowRefresh_mapIndex_CurrentPixelGroup - 1].rowOffset == currentRowOffset))
-            multiRowRefresh_mapIndex_CurrentPixelGroup--;
-
-        // we need to set the total offset to the beginning offset of the next panel.  Calculate what that would be
-        multiRowRefresh_NumPanelsAlreadyMapped++;
-        multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = multiRowRefresh_NumPanelsAlreadyMapped * COLS_PER_PANEL * PHYSICAL_ROWS_PER_REFRESH_ROW;
-    }
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildStackedPanelRowSources(void) {
+    buildHub75StackedPanelRowSources(stackedPanelRowSources, getMultiRowRefreshPanelMap(panelType), MATRIX_SCAN_MOD,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, MATRIX_STACK_HEIGHT, MATRIX_PANEL_HEIGHT, ROW_PAIR_OFFSET,
+        (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING), (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING),
+        hub75StackOrderTeensy);
 }
 
-// returns the row offset from the map, or -1 if we've gone through the whole map already
+// fills refreshBufferPositions with the position in the refresh buffer of each temp row pixel, following the panel map
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshRowOffset(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])){
-        return -1;
-    }
-
-    return map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;    
-}
-
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshNumPixelsToMap(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].numPixels;    
-}
-
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshPixelGroupOffset(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
-
-    return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::buildRefreshBufferPositions(void) {
+    buildHub75RefreshBufferPositions(refreshBufferPositions, getMultiRowRefreshPanelMap(panelType), PIXELS_PER_LATCH,
+        PHYSICAL_ROWS_PER_REFRESH_ROW, COLS_PER_PANEL);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -364,174 +408,78 @@ FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight
         Bit depths are supported from 1 bit per color channel (3 bits per pixel) to 16 bits per color channel (48 bits per pixel). */
 
     int i;
-    int multiRowRefreshRowOffset = 0;
     const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
     // Temporary buffers to store rgb pixel data for reformatting (static to avoid putting large buffer on the stack)
     static rgb48 tempRow0[numPixelsPerTempRow];
     static rgb48 tempRow1[numPixelsPerTempRow];
 
-    int c = 0;
-
-    // multi row refresh isn't very efficient, slowing this function down by ~30% for panels that don't even need multi row refresh.  For now, only enable the code if needed
-    if(MULTI_ROW_REFRESH_REQUIRED) { 
-        resetMultiRowRefreshMapPosition();
-    }
-
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing
-        memset((void *)tempRow0, 0, sizeof(tempRow0));
-        memset((void *)tempRow1, 0, sizeof(tempRow1));
-
+    for(int physicalRow = 0; physicalRow < PHYSICAL_ROWS_PER_REFRESH_ROW; physicalRow++) {
         // Get pixel data from layers and store in tempRow0 and tempRow1
         // Scan through the entire chain of panels and extract rows from each one
-        // using the stacking options to get the correct rows (some panels can be upside down).
-        SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-        int y0, y1; // positions of the two rows we need
-        while (templayer) {
-            for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
-                // Z-shape, bottom to top
-                if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                        (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + i * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // Z-shape, top to bottom
-                } else if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // C-shape, bottom to top
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (i) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (i) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
-                // C-shape, top to bottom
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
-                }
-                templayer->fillRefreshRow(y0, &tempRow0[i * matrixWidth]);
-                templayer->fillRefreshRow(y1, &tempRow1[i * matrixWidth]);
+        // using the rows calculated for each stacked panel by buildStackedPanelRowSources() (some panels can be upside down).
+        // The compositor clears the pixels no layer covers
+        const StackedPanelRowSource * rowSources = &stackedPanelRowSources[(currentRow * PHYSICAL_ROWS_PER_REFRESH_ROW + physicalRow) * MATRIX_STACK_HEIGHT];
+        for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+            SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y0, matrixWidth, &tempRow0[i * matrixWidth]);
+            SmartMatrixLayerCompositor::fillRefreshRow(baseLayer, rowSources[i].y1, matrixWidth, &tempRow1[i * matrixWidth]);
+
+            if(panelCalibrationEnabled) {
+                calibrateHub75Pixels(&tempRow0[i * matrixWidth], matrixWidth, 0, rowSources[i].y0, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
+                calibrateHub75Pixels(&tempRow1[i * matrixWidth], matrixWidth, 0, rowSources[i].y1, panelCalibrations, COLS_PER_PANEL, MATRIX_PANEL_HEIGHT, MATRIX_PANELS_PER_ROW);
             }
-            templayer = templayer->nextLayer;
-        }
 
-        i=0;
-
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+            if(powerLimitMaxLoad < 255)
+                powerLimitFrameSum += sumHub75Pixels(&tempRow0[i * matrixWidth], matrixWidth) + sumHub75Pixels(&tempRow1[i * matrixWidth], matrixWidth);
+
+            // carry the bits below COLOR_DEPTH_BITS across frames instead of dropping them
+            if((optionFlags & SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING) && COLOR_DEPTH_BITS < 16) {
+                temporalDitherHub75Row(&tempRow0[i * matrixWidth], matrixWidth, rowSources[i].y0, ditherFrameCount, 16 - COLOR_DEPTH_BITS);
+                temporalDitherHub75Row(&tempRow1[i * matrixWidth], matrixWidth, rowSources[i].y1, ditherFrameCount, 16 - COLOR_DEPTH_BITS);
+            } else if((optionFlags & SMARTMATRIX_OPTIONS_SPATIAL_DITHERING) && COLOR_DEPTH_BITS < 16) {
+                // or spread them over neighbouring pixels
+                orderedDitherHub75Row(&tempRow0[i * matrixWidth], matrixWidth, 0, rowSources[i].y0, 0, 16 - COLOR_DEPTH_BITS);
+                orderedDitherHub75Row(&tempRow1[i * matrixWidth], matrixWidth, 0, rowSources[i].y1, 0, 16 - COLOR_DEPTH_BITS);
+            }
         }
 
-        while(i < numPixelsPerTempRow) {
+        // multi row refresh panels write pixels to the positions calculated by buildRefreshBufferPositions(), other panels write pixels in order
+        const uint16_t * positions = &refreshBufferPositions[MULTI_ROW_REFRESH_REQUIRED ? physicalRow * numPixelsPerTempRow : 0];
 
-            int numPixelsToMap;
-            int currentMapOffset;
-            bool reversePixelBlock;
+        // parse through the temp rows in blocks, extracting all bitplanes of a block at once and writing them to the refresh buffer
+        int numBlockPixels;
+        for(i=0; i < numPixelsPerTempRow; i += numBlockPixels) {
+            int ind, step;
 
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                // get number of pixels to go through with current pass
-                numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+            // keep each block within one stack, so upside down stacks can be read in reverse
+            int currentStack = i/matrixWidth;
+            numBlockPixels = min(HUB75_BITPLANE_BLOCK_PIXELS, numPixelsPerTempRow - i);
+            numBlockPixels = min(numBlockPixels, matrixWidth - (i%matrixWidth));
 
-                reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
-
-                // get offset where pixels are written in the refresh buffer
-                currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+            // for upside down stacks, flip order
+            if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
+                // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
+                ind = (currentStack*matrixWidth) + (matrixWidth-1) - (i%matrixWidth);
+                step = -1;
             } else {
-                numPixelsToMap = matrixWidth;
+                // load data to buffer in normal order
+                ind = i;
+                step = 1;
             }
 
-            // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-            for(int k=0; k < numPixelsToMap; k++) {
-                uint16_t r0, g0, b0, r1, g1, b1;
-                int ind;
-
-                int refreshBufferPosition;
-                if(MULTI_ROW_REFRESH_REQUIRED) { 
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
-                } else {
-                    refreshBufferPosition = i+k;
-                }
-
-                // for upside down stacks, flip order
-                int currentStack = i/matrixWidth;
-                if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
-                    // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
-                    ind = (currentStack*matrixWidth) + (matrixWidth-1) - ((i+k)%matrixWidth);
-                } else {
-                    // load data to buffer in normal order
-                    ind = i+k;
-                }
-                r0 = tempRow0[ind].red;
-                g0 = tempRow0[ind].green;
-                b0 = tempRow0[ind].blue;
-                r1 = tempRow1[ind].red;
-                g1 = tempRow1[ind].green;
-                b1 = tempRow1[ind].blue;
-
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    r0 = ~r0;
-                }
+            // extract the bitplanes used at this color depth, and format the bits to match the FlexIO pin configuration
+            uint8_t bitplanes[COLOR_DEPTH_BITS][HUB75_BITPLANE_BLOCK_PIXELS];
+            extractHub75Bitplanes(&tempRow0[ind], &tempRow1[ind], step, numBlockPixels, 16 - COLOR_DEPTH_BITS, COLOR_DEPTH_BITS, bitplanes);
 
-                // loop through each bitplane in the current pixel's RGB values and format the bits to match the FlexIO pin configuration
-                uint32_t rgbdata;
-                uint8_t shift = (16 - COLOR_DEPTH_BITS);
-                uint16_t mask = 1 << shift;
+            for(int b=0; b < numBlockPixels; b++) {
+                int refreshBufferPosition = MULTI_ROW_REFRESH_REQUIRED ? positions[i+b] : i+b;
 
                 for (int bitindex = 0; bitindex < COLOR_DEPTH_BITS; bitindex++) {
-                    rgbdata  = (r0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().r0);
-                    rgbdata |= (g0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().g0);
-                    rgbdata |= (b0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().b0);
-                    rgbdata |= (r1 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().r1);
-                    rgbdata |= (g1 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().g1);
-                    rgbdata |= (b1 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().b1);
-                    rgbdata >>= shift;
-
-                    shift++;
-                    mask <<= 1;
-
                     // store these pixel bits in the rowDataBuffer, leaving the initial pixels as padding
-                    currentRowDataPtr->rowbits[bitindex].data[PAD_PIXELS + refreshBufferPosition] = rgbdata;
+                    currentRowDataPtr->rowbits[bitindex].data[PAD_PIXELS + refreshBufferPosition] = colorIndexWords[bitplanes[bitindex][b]];
                 }
             }
-            i += numPixelsToMap; // keep track of current position on this temp buffer
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                advanceMultiRowRefreshMapToNextPixelGroup();
-            }
         }
 
         unsigned int addressbits;
@@ -543,14 +491,7 @@ FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight
 
         // record the address in the first rowAddress field in the rowBitStruct (other rowAddress fields are unused)
         currentRowDataPtr->rowbits[0].rowAddress = addressbits;
-
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
-
-            advanceMultiRowRefreshMapToNextRow();
-            multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-        }
-    } while (MULTI_ROW_REFRESH_REQUIRED ? (multiRowRefreshRowOffset > 0) : 0);
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
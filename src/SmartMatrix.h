@@ -53,6 +53,10 @@
 #include "Layer_Scrolling.h"
 #include "Layer_Indexed.h"
 #include "Layer_Background.h"
+#include "Layer_Sprites.h"
+#include "Layer_Tilemap.h"
+#include "MatrixCalcProfiler.h"
+#include "MatrixLayerCompositor.h"
 
 // For backwards compatiblity, this needs to be defined at the top of the sketch, so that "Adafruit_GFX.h" is only included if desired
 #ifdef USE_ADAFRUIT_GFX_LAYERS
@@ -65,6 +69,7 @@
 #endif
 
 #include "MatrixCommonHub75.h"
+#include "MatrixHub75Bitplanes.h"
 
 #include "MatrixCommonApa102.h"
 #include "MatrixCommonApa102Refresh.h"
@@ -75,6 +80,7 @@
 #endif
 
 #include "MatrixPanelMaps.h"
+#include "MatrixHub75PanelTables.h"
 
 #if defined(__arm__) && defined(CORE_TEENSY) && !defined(__IMXRT1062__)  // Teensy 3.x
     #include "MatrixTeensy3Hub75Refresh.h"
@@ -160,7 +166,7 @@
 
         #define SMARTMATRIX_ALLOCATE_INDEXED_LAYER(layer_name, width, height, storage_depth, indexed_options) \
             typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
-            static uint8_t layer_name##Bitmap[2 * width * (height / 8)];                                              \
+            static uint8_t layer_name##Bitmap[2 * width * (height / 8) * SM_INDEXED_BITS_PER_PIXEL(indexed_options)];                                              \
             static SMLayerIndexed<RGB_TYPE(storage_depth), indexed_options> layer_name(layer_name##Bitmap, width, height)  
 #endif
 #endif
@@ -210,6 +216,16 @@
 #endif
 #endif
 
+// the sprite layer allocates its sprite descriptors and row lists in begin() on all platforms
+#define SMARTMATRIX_ALLOCATE_SPRITE_LAYER(layer_name, width, height, storage_depth, max_sprites, sprite_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerSprites<RGB_TYPE(storage_depth), sprite_options> layer_name(width, height, max_sprites)
+
+// the tilemap layer has no frame buffer, the sketch provides the tileset and map
+#define SMARTMATRIX_ALLOCATE_TILEMAP_LAYER(layer_name, width, height, storage_depth, tilemap_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerTilemap<RGB_TYPE(storage_depth), tilemap_options> layer_name(width, height)
+
 // platform-specific
 #if defined(__arm__) && defined(CORE_TEENSY) && !defined(__IMXRT1062__)  // Teensy 3.x
     #include "MatrixTeensy3Hub75Refresh_Impl.h"
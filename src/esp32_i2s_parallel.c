@@ -35,6 +35,8 @@
 typedef struct {
     volatile lldesc_t *dmadesc_a, *dmadesc_b;
     int desccount_a, desccount_b;
+    lldesc_t ** dmadesc_extra;
+    int num_dmadesc_extra;
 } i2s_parallel_state_t;
 
 static i2s_parallel_state_t *i2s_state[2]={NULL, NULL};
@@ -371,6 +373,8 @@ void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config
     st->desccount_b = cfg->desccount_b;
     st->dmadesc_a = cfg->lldesc_a;
     st->dmadesc_b = cfg->lldesc_b;
+    st->dmadesc_extra = cfg->lldesc_extra;
+    st->num_dmadesc_extra = cfg->num_lldesc_extra;
 
     //Reset FIFO/DMA -> needed? Doesn't dma_reset/fifo_reset do this?
     dev->lc_conf.in_rst=1; dev->lc_conf.out_rst=1; dev->lc_conf.ahbm_rst=1; dev->lc_conf.ahbm_fifo_rst=1;
@@ -390,20 +394,25 @@ void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config
     dev->conf.tx_start=1;
 }
 
-//Flip to a buffer: 0 for bufa, 1 for bufb
+//Flip to a buffer: 0 for bufa, 1 for bufb, 2 and up for lldesc_extra chains
 void i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid) {
     int no=i2snum(dev);
     if (i2s_state[no]==NULL) return;
     lldesc_t *active_dma_chain;
     if (bufid==0) {
         active_dma_chain=(lldesc_t*)&i2s_state[no]->dmadesc_a[0];
-    } else {
+    } else if (bufid==1) {
         active_dma_chain=(lldesc_t*)&i2s_state[no]->dmadesc_b[0];
+    } else {
+        active_dma_chain=&i2s_state[no]->dmadesc_extra[bufid-2][0];
     }
 
     // setup linked list to refresh from new buffer (continuously) when the end of the current list has been reached
+    // every chain is pointed at the new buffer, so a buffer flipped to before the current list ends is skipped
     i2s_state[no]->dmadesc_a[i2s_state[no]->desccount_a-1].qe.stqe_next=active_dma_chain;
     i2s_state[no]->dmadesc_b[i2s_state[no]->desccount_b-1].qe.stqe_next=active_dma_chain;
+    for(int i=0; i<i2s_state[no]->num_dmadesc_extra; i++)
+        i2s_state[no]->dmadesc_extra[i][i2s_state[no]->desccount_a-1].qe.stqe_next=active_dma_chain;
 
     // we're still refreshing the previously buffer, so it shouldn't be written to yet
     previousBufferFree = false;
@@ -35,6 +35,9 @@ typedef struct {
     int desccount_b;
     lldesc_t * lldesc_a;
     lldesc_t * lldesc_b;
+    // optional chains for buffers 2 and up, each with desccount_a descriptors
+    lldesc_t ** lldesc_extra;
+    int num_lldesc_extra;
 } i2s_parallel_config_t;
 
 void i2s_parallel_setup(i2s_dev_t *dev, const i2s_parallel_config_t *cfg);